@@ -1,7 +1,7 @@
 #pragma once
 
 #include "coap/ResourceInterface.h"
-#include "coap/Session.h"
+#include "coap/SessionView.h"
 #include "coap/DataStruct/Address.h"
 #include "coap/Pdu/RequestPdu.h"
 #include "coap/Pdu/ResponsePdu.h"
@@ -22,7 +22,7 @@ public:
      : m_text(text), ResourceInterface(code) {  }
     ~ResourceInterfaceExample() noexcept { }
 
-    void onRequest(Session session, std::string query, ResponsePdu response, RequestPdu request) override
+    void onRequest(SessionView session, std::string query, ResponsePdu response, RequestPdu request) override
     {
         auto code = request.code();
         switch (code)
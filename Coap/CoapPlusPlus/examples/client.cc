@@ -68,7 +68,7 @@ int main(void)
   auto &manager = session->getSendersManager();
 
   auto state = false;
-  client.registerHandshakeResponedFunction([&state](const CoapPlusPlus::Session* session, 
+  client.registerHandshakeResponedFunction([&state](const CoapPlusPlus::SessionView* session, 
                                                 const CoapPlusPlus::ResponsePdu* response, int id) 
     {
         if(session) {
@@ -8,6 +8,7 @@
 #include "coap/ResourceManager.h"
 #include "ResourceInterfaceExample.h"
 #include <string>
+#include <cstdio>
 
 using namespace CoapPlusPlus;
 int main(void)
@@ -43,12 +44,16 @@ int main(void)
     return -1;
   }
 
-  Log::Logging(LOG_LEVEL::INFO, "server start!\n");
-  //std::flush(std::cout);
-  while (true)
+  /* 在后台I/O线程中处理网络I/O */
+  if (server.startIOProcess(0) == false)
   {
-    server.ioProcess(0);
+    Log::Logging(LOG_LEVEL::ERR, "start I/O thread failed!");
+    return -1;
   }
+  Log::Logging(LOG_LEVEL::INFO, "server start! press Enter to stop.\n");
+  //std::flush(std::cout);
+  std::getchar();
+  server.stopIOProcess();
 
   return 0;
 }
@@ -0,0 +1 @@
+#include "../../src/Utils/AdmissionController.h"
\ No newline at end of file
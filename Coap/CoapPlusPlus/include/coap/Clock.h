@@ -0,0 +1 @@
+#include "../../src/Utils/Clock.h"
\ No newline at end of file
@@ -0,0 +1 @@
+#include "../../src/ContextServerGroup.h"
\ No newline at end of file
@@ -0,0 +1 @@
+#include "../../src/Utils/HealthProbe.h"
\ No newline at end of file
@@ -0,0 +1 @@
+#include "../../src/IOHub.h"
\ No newline at end of file
@@ -0,0 +1 @@
+#include "../../src/RequestAwaitable.h"
\ No newline at end of file
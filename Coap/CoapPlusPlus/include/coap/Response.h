@@ -0,0 +1 @@
+#include "../../src/Response.h"
\ No newline at end of file
@@ -0,0 +1 @@
+#include "../../src/SessionView.h"
\ No newline at end of file
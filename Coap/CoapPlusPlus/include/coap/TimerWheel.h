@@ -0,0 +1 @@
+#include "../../src/Utils/TimerWheel.h"
\ No newline at end of file
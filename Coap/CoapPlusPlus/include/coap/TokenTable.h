@@ -0,0 +1 @@
+#include "../../src/Utils/TokenTable.h"
\ No newline at end of file
@@ -1,35 +1,119 @@
 #include "Context.h"
 #include "EventHandling.h"
+#include "IOHub.h"
+#include "SendersManager.h"
+#include "utils/TimerWheel.h"
+#include "utils/Clock.h"
 #include <coap3/coap.h>
+#include <algorithm>
+#include <chrono>
+#include <utility>
 #include "coap/exception.h"
 
+#ifdef __linux__
+#include <sys/eventfd.h>
+#include <sys/epoll.h>
+#include <sys/select.h>
+#include <sys/mman.h>
+#include <sys/resource.h>
+#include <sys/syscall.h>
+#include <pthread.h>
+#include <sched.h>
+#include <unistd.h>
+#include <cerrno>
+#include <cstring>
+#endif
+
 namespace CoapPlusPlus {
 
-// bool Context::startIOProcess(int waitMs) noexcept
-// {
-//     if(isReady() == false) {
-//         coap_log_warn("没有添加endpoint或者session, 无法开始IO处理\n");
-//         return false;
-//     }
-//     //stopIOProcess();
-//     std::lock_guard<std::mutex> lock(m_mutex);
-//     m_flag = true;
-//     m_thread = new std::thread(&Context::startIOProcessThreadFunc, this, waitMs);
-//     return true;
-// }
-
-// void Context::stopIOProcess() noexcept
-// {
-//     {
-//         std::lock_guard<std::mutex> lock(m_mutex);
-//         m_flag = false;
-//     }
-//     if(m_thread) {
-//         m_thread->join();
-//         delete m_thread;
-//         m_thread = nullptr;
-//     }
-// }
+// 不支持唤醒时，I/O线程每次coap_io_process最多阻塞的毫秒数，保证stopIOProcess()能及时返回
+static constexpr uint32_t IO_PROCESS_MAX_BLOCK_MS = 100;
+// processIO()每次从epoll中取出的最大事件数量
+static constexpr int EXTERNAL_IO_MAX_EVENTS = 16;
+// 每次网络I/O处理最多执行的定时器回调数量，避免大量定时器同时到期时饿死网络I/O
+static constexpr int TIMER_MAX_PER_IO = 64;
+// 忙轮询退回到阻塞等待后，每次阻塞的最长毫秒数
+static constexpr uint32_t BUSY_POLL_MAX_SLEEP_MS = 64;
+
+bool Context::startIOProcess(int waitMs) noexcept
+{
+    if(isReady() == false) {
+        coap_log_warn("No endpoint or session added, unable to start the I/O thread.\n");
+        return false;
+    }
+    if(m_shutdown) {
+        coap_log_warn("The context is shutting down, unable to start the I/O thread.\n");
+        return false;
+    }
+    if(m_ioThreadId.load() == std::this_thread::get_id()) {
+        coap_log_warn("The I/O thread is already running.\n");
+        return false;
+    }
+    std::lock_guard<std::mutex> threadLock(m_threadMutex);
+    if(m_thread != nullptr) {
+        if(m_running) {
+            coap_log_warn("The I/O thread is already running.\n");
+            return false;
+        }
+        // 上一个I/O线程因为错误已经退出，或者在回调中被停止
+        joinIOThread();
+    }
+    if(isBusy()) {
+        coap_log_warn("ioProcess() is in progress in another thread, unable to start the I/O thread.\n");
+        return false;
+    }
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if(m_ioHub != nullptr) {
+        coap_log_warn("The context has been added to an IOHub, unable to start its own I/O thread.\n");
+        return false;
+    }
+    m_running = true;
+    m_thread = new std::thread(&Context::ioProcessThreadFunc, this, waitMs, m_ioThreadOptions);
+    return true;
+}
+
+void Context::setIOThreadOptions(const IOThreadOptions& options) noexcept
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_ioThreadOptions = options;
+}
+
+Context::IOThreadOptions Context::getIOThreadOptions() const noexcept
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_ioThreadOptions;
+}
+
+void Context::stopIOProcess() noexcept
+{
+    // I/O线程不能等待自己退出，回调返回后线程会看到m_running并退出
+    if(m_ioThreadId.load() == std::this_thread::get_id()) {
+        m_running = false;
+        return;
+    }
+    // 等待线程退出时只持有m_threadMutex，I/O线程的回调中仍然可以使用m_mutex保护的接口
+    std::lock_guard<std::mutex> threadLock(m_threadMutex);
+    m_running = false;
+    wakeup();
+    joinIOThread();
+}
+
+void Context::joinIOThread() noexcept
+{
+    if(m_thread == nullptr)
+        return;
+    if(m_thread->joinable())
+        m_thread->join();
+    delete m_thread;
+    m_thread = nullptr;
+    m_ioThreadId = std::thread::id();
+}
+
+void Context::registerIOProcessObserver(std::function<void(int)> observer) noexcept
+{
+    std::lock_guard<std::mutex> lock(m_observerMutex);
+    m_ioProcessObserver = observer;
+}
 
 void Context::registerEventHandling(std::unique_ptr<EventHandling> eventHandling) noexcept
 {
@@ -54,21 +138,158 @@ int Context::ioProcess(int waitMs)
     if(isReady() == false) {
         throw DataNotReadyException("No endpoint or session added, no network I/O possible.");
     }
-    m_isBusy = true;
+    if(isIOProcessRunning()) {
+        coap_log_warn("The I/O thread is running, ioProcess() is not allowed.\n");
+        return -1;
+    }
+    if(enterIOProcess() == false) {
+        coap_log_warn("The context is shutting down or busy in another thread, ioProcess() is not allowed.\n");
+        return -1;
+    }
     auto wait_ms = waitMs > 0 
                     ? waitMs 
                     : waitMs == 0 ? COAP_IO_WAIT : COAP_IO_NO_WAIT;
-    auto result = coap_io_process(m_ctx, wait_ms);
-    m_isBusy = false;
+    auto result = doIOProcess(wait_ms);
+    leaveIOProcess();
     return result;
 }
 
+int Context::getFileDescriptor() const noexcept
+{
+#ifdef __linux__
+    if(coap_epoll_is_supported())
+        return coap_context_get_coap_fd(m_ctx);
+#endif
+    return -1;
+}
+
+int Context::prepareIO()
+{
+    checkExternalIO();
+    if(enterIOProcess() == false)
+        throw InternalException("The context is shutting down or busy in another thread.");
+    beforeIOProcess();
+    runTimers();
+    coap_tick_t now;
+    coap_ticks(&now);
+    // 返回0表示没有需要等待的定时事件
+    auto timeout = coap_io_prepare_epoll(m_ctx, now);
+    timeout = clampWaitToTimers(timeout == 0 ? COAP_IO_WAIT : timeout);
+    leaveIOProcess();
+    if(timeout == COAP_IO_WAIT)
+        return -1;
+    return timeout == COAP_IO_NO_WAIT ? 0 : static_cast<int>(timeout);
+}
+
+void Context::processIO()
+{
+    checkExternalIO();
+    if(enterIOProcess() == false)
+        throw InternalException("The context is shutting down or busy in another thread.");
+#ifdef __linux__
+    struct epoll_event events[EXTERNAL_IO_MAX_EVENTS];
+    auto count = epoll_wait(coap_context_get_coap_fd(m_ctx), events, EXTERNAL_IO_MAX_EVENTS, 0);
+    if(count > 0) {
+        coap_io_do_epoll(m_ctx, events, count);
+        afterIOProcess();
+    }
+    wakeupDrain();
+#endif
+    runTimers();
+    leaveIOProcess();
+}
+
+size_t Context::drainReadyIO(size_t maxEvents) noexcept
+{
+    size_t handled = 0;
+#ifdef __linux__
+    auto fd = coap_context_get_coap_fd(m_ctx);
+    if(fd < 0)
+        return 0;
+    struct epoll_event events[EXTERNAL_IO_MAX_EVENTS];
+    while(handled < maxEvents) {
+        auto max = static_cast<int>(std::min<size_t>(EXTERNAL_IO_MAX_EVENTS, maxEvents - handled));
+        auto count = epoll_wait(fd, events, max, 0);
+        if(count <= 0)
+            break;
+        coap_io_do_epoll(m_ctx, events, count);
+        // 唤醒描述符和libcoap的定时器描述符的data.ptr为空，不对应数据报
+        size_t sockets = 0;
+        for(int i = 0; i < count; i++) {
+            if(events[i].data.ptr != nullptr)
+                sockets++;
+        }
+        if(sockets == 0)
+            break;
+        handled += sockets;
+    }
+#endif
+    return handled;
+}
+
+void Context::wakeup() noexcept
+{
+#ifdef __linux__
+    if(m_wakeupFd >= 0) {
+        uint64_t one = 1;
+        auto n = ::write(m_wakeupFd, &one, sizeof(one));
+        (void)n; // 计数器溢出时(EAGAIN)说明已经处于唤醒状态
+    }
+#endif
+}
+
+bool Context::setClock(std::unique_ptr<Clock> clock) noexcept
+{
+    // 进行网络I/O的线程会读取时钟，只有没有线程在进行网络I/O时才能更换
+    if(isIOProcessRunning() || isInIOHub() || isBusy()) {
+        coap_log_warn("setClock: network I/O is driven by another thread.\n");
+        return false;
+    }
+    std::lock_guard<std::mutex> lock(m_timerMutex);
+    if(m_timers->empty() == false) {
+        coap_log_warn("There are pending timers, unable to change the clock.\n");
+        return false;
+    }
+    delete m_clock;
+    m_clock = clock ? clock.release() : new SteadyClock;
+    // 时间轮的内部时间要与新时钟一致
+    delete m_timers;
+    m_timers = new TimerWheel(m_clock->nowMs());
+    return true;
+}
+
+Context::TimerId Context::addTimer(int delayMs, std::function<void()> callback, int periodMs)
+{
+    auto period = static_cast<uint64_t>(periodMs > 0 ? periodMs : 0);
+    TimerId id;
+    {
+        std::lock_guard<std::mutex> lock(m_timerMutex);
+        auto expire = m_clock->nowMs() + static_cast<uint64_t>(delayMs > 0 ? delayMs : 0);
+        id = m_timers->schedule(expire, period, std::move(callback));
+    }
+    // 让正在等待的网络I/O重新计算等待时间
+    wakeup();
+    return id;
+}
+
+bool Context::cancelTimer(TimerId id) noexcept
+{
+    std::lock_guard<std::mutex> lock(m_timerMutex);
+    return m_timers->cancel(id);
+}
+
 bool Context::isioPending() const noexcept
 {
     auto result = coap_io_pending(m_ctx);
     return result == 0 ? false : true;
 }
 
+bool Context::isInIOHub() const noexcept
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_ioHub != nullptr;
+}
+
 Context::Context()
 {
     coap_startup();
@@ -79,10 +300,15 @@ Context::Context()
     coap_context_set_block_mode(m_ctx, COAP_BLOCK_USE_LIBCOAP | COAP_BLOCK_SINGLE_BODY);
     coap_set_app_data(m_ctx, this);
     coap_set_show_pdu_output(0);
+    // 响应处理函数对整个上下文只注册一次，不随SendersManager的创建重复注册
+    SendersManager::RegisterContextHandlers(m_ctx);
+    m_clock = new SteadyClock;
+    m_timers = new TimerWheel(m_clock->nowMs());
+    wakeupInit();
 }
 
 Context::~Context() {
-    while(isBusy());
+    shutdownIOProcess();
     if (m_ctx != nullptr) {
         coap_set_app_data(m_ctx, nullptr);
         coap_free_context(m_ctx);
@@ -92,33 +318,398 @@ Context::~Context() {
         }
         m_ctx = nullptr;
     }
+    if(m_timers) {
+        delete m_timers;
+        m_timers = nullptr;
+    }
+    if(m_clock) {
+        delete m_clock;
+        m_clock = nullptr;
+    }
+#ifdef __linux__
+    if(m_wakeupFd >= 0) {
+        ::close(m_wakeupFd);
+        m_wakeupFd = -1;
+    }
+#endif
     coap_cleanup();
 }
 
-// void Context::startIOProcessThreadFunc(int waitMs) noexcept
-// {
-//     auto wait_ms = waitMs > 0 ? waitMs : 
-//     waitMs == 0 ? COAP_IO_WAIT : COAP_IO_NO_WAIT;
-//     coap_context_t *temp_ctx;
-//     while (true) { 
-//         bool flag; 
-//         {
-//             std::lock_guard<std::mutex> lock(m_mutex);
-//             flag = m_flag;
-//             temp_ctx = m_ctx;
-//         }
-//         if (!flag) break;
-        
-//         auto result = coap_io_process(temp_ctx, wait_ms);
-//         if (result < 0) 
-//             break; 
-//         else if ((uint32_t)result && ((uint32_t)result < wait_ms))
-//             wait_ms -= result; 
-//         else {
-//             wait_ms = waitMs > 0 ? waitMs : 
-//             waitMs == 0 ? COAP_IO_WAIT : COAP_IO_NO_WAIT;;
-//         }
-//     }
-// }
+void Context::ioProcessThreadFunc(int waitMs, IOThreadOptions options) noexcept
+{
+    m_ioThreadId = std::this_thread::get_id();
+    applyIOThreadOptions(options);
+    const uint32_t timeout = waitMs > 0 
+                    ? waitMs 
+                    : waitMs == 0 ? COAP_IO_WAIT : COAP_IO_NO_WAIT;
+    m_busyPollSpinUs = 0;
+    m_busyPollSleepUs = 0;
+    m_busyPollSpinPolls = 0;
+    m_busyPollSpinHits = 0;
+    m_busyPollSleeps = 0;
+    if(options.busyPollUs > 0) {
+        if(getFileDescriptor() >= 0) {
+            busyPollThreadFunc(timeout, options.busyPollUs);
+            return;
+        }
+        coap_log_warn("libcoap does not support epoll, busy polling is disabled.\n");
+    }
+    uint32_t wait_ms = timeout;
+    std::function<void(int)> observer;
+    while(m_running) {
+        // 不能被唤醒时，无限等待也要分段阻塞，否则无法及时响应stopIOProcess()
+        auto block_ms = m_wakeupFd < 0 && wait_ms != COAP_IO_NO_WAIT
+                        && (wait_ms == COAP_IO_WAIT || wait_ms > IO_PROCESS_MAX_BLOCK_MS)
+                        ? IO_PROCESS_MAX_BLOCK_MS 
+                        : wait_ms;
+        if(enterIOProcess() == false) {
+            if(waitToEnterIOProcess() == false)
+                break;
+            continue;
+        }
+        auto result = doIOProcess(block_ms);
+        leaveIOProcess();
+        if(result < 0) {
+            coap_log_err("coap_io_process() failed, the I/O thread exits.\n");
+            break;
+        }
+        {
+            std::lock_guard<std::mutex> lock(m_observerMutex);
+            observer = m_ioProcessObserver;
+        }
+        if(observer)
+            observer(result);
+        // 扣除已经花费的时间，直到waitMs用完才重新计时
+        if(timeout != COAP_IO_WAIT && timeout != COAP_IO_NO_WAIT && (uint32_t)result < wait_ms)
+            wait_ms -= result;
+        else
+            wait_ms = timeout;
+    }
+    m_running = false;
+}
+
+void Context::busyPollThreadFunc(uint32_t timeout, int windowUs) noexcept
+{
+    using namespace std::chrono;
+    // 阻塞时间的上限不超过startIOProcess()的waitMs，保证观察函数的调用频率
+    const uint32_t maxSleepMs = timeout == COAP_IO_WAIT || timeout == COAP_IO_NO_WAIT 
+                                ? BUSY_POLL_MAX_SLEEP_MS 
+                                : std::min(timeout, BUSY_POLL_MAX_SLEEP_MS);
+    const auto window = microseconds(windowUs);
+    auto spinUntil = steady_clock::now() + window;
+    uint32_t sleepMs = 1;
+    std::function<void(int)> observer;
+    while(m_running) {
+        auto begin = steady_clock::now();
+        bool spinning = begin < spinUntil;
+        if(enterIOProcess() == false) {
+            if(waitToEnterIOProcess() == false)
+                break;
+            continue;
+        }
+        auto sockets = pollReadyIO(spinning ? 0 : sleepMs, spinning == false);
+        leaveIOProcess();
+        if(sockets < 0) {
+            coap_log_err("epoll_wait() failed, the I/O thread exits.\n");
+            break;
+        }
+        auto end = steady_clock::now();
+        auto elapsedUs = static_cast<uint64_t>(duration_cast<microseconds>(end - begin).count());
+        if(spinning) {
+            m_busyPollSpinUs.fetch_add(elapsedUs, std::memory_order_relaxed);
+            m_busyPollSpinPolls.fetch_add(1, std::memory_order_relaxed);
+            if(sockets > 0)
+                m_busyPollSpinHits.fetch_add(1, std::memory_order_relaxed);
+        }
+        else {
+            m_busyPollSleepUs.fetch_add(elapsedUs, std::memory_order_relaxed);
+            m_busyPollSleeps.fetch_add(1, std::memory_order_relaxed);
+        }
+        // 收到数据报后重新开始忙轮询；阻塞等待超时则加倍下一次的阻塞时间
+        if(sockets > 0) {
+            spinUntil = end + window;
+            sleepMs = 1;
+        }
+        else if(spinning == false) {
+            sleepMs = std::min(sleepMs * 2, maxSleepMs);
+        }
+        // 空转的忙轮询不通知观察函数
+        if(sockets == 0 && spinning)
+            continue;
+        {
+            std::lock_guard<std::mutex> lock(m_observerMutex);
+            observer = m_ioProcessObserver;
+        }
+        if(observer)
+            observer(static_cast<int>(elapsedUs / 1000));
+    }
+    m_running = false;
+}
+
+int Context::pollReadyIO(uint32_t timeoutMs, bool idle) noexcept
+{
+    int sockets = 0;
+#ifdef __linux__
+    beforeIOProcess();
+    runTimers();
+    coap_tick_t now;
+    coap_ticks(&now);
+    // 发送待发的数据，并且不能错过libcoap内部的定时事件(如重传)
+    auto next = coap_io_prepare_epoll(m_ctx, now);
+    if(timeoutMs > 0) {
+        if(next > 0 && next < timeoutMs)
+            timeoutMs = next;
+        timeoutMs = clampWaitToTimers(timeoutMs);
+        if(timeoutMs == COAP_IO_NO_WAIT)
+            timeoutMs = 0;
+    }
+    struct epoll_event events[EXTERNAL_IO_MAX_EVENTS];
+    auto count = epoll_wait(coap_context_get_coap_fd(m_ctx), events, EXTERNAL_IO_MAX_EVENTS, static_cast<int>(timeoutMs));
+    if(count < 0 && errno != EINTR)
+        return -1;
+    if(count > 0) {
+        coap_io_do_epoll(m_ctx, events, count);
+        for(int i = 0; i < count; i++) {
+            if(events[i].data.ptr != nullptr)
+                sockets++;
+        }
+    }
+    // 忙轮询时只在有事件时调用，阻塞等待时每次都调用，保证空闲会话回收等周期性的工作能够进行
+    if(count > 0 || idle)
+        afterIOProcess();
+    wakeupDrain();
+    runTimers();
+#endif
+    return sockets;
+}
+
+int Context::doIOProcess(uint32_t waitMs) noexcept
+{
+    beforeIOProcess();
+    runTimers();
+    waitMs = clampWaitToTimers(waitMs);
+    int result = 0;
+#ifdef __linux__
+    if(m_wakeupFd >= 0 && coap_epoll_is_supported() == 0) {
+        // select()模式下，唤醒描述符需要随coap_io_process一起等待
+        fd_set readfds;
+        FD_ZERO(&readfds);
+        FD_SET(m_wakeupFd, &readfds);
+        result = coap_io_process_with_fds(m_ctx, waitMs, m_wakeupFd + 1, &readfds, nullptr, nullptr);
+    }
+    else {
+        result = coap_io_process(m_ctx, waitMs);
+    }
+#else
+    result = coap_io_process(m_ctx, waitMs);
+#endif
+    if(result >= 0)
+        afterIOProcess();
+    wakeupDrain();
+    if(result >= 0)
+        runTimers();
+    return result;
+}
+
+void Context::runTimers() noexcept
+{
+    auto now = nowMs();
+    for(int i = 0; i < TIMER_MAX_PER_IO; i++) {
+        TimerWheel::Expired expired;
+        {
+            std::lock_guard<std::mutex> lock(m_timerMutex);
+            if(m_timers->popExpired(now, expired) == false)
+                return;
+        }
+        // 执行回调时不持有锁，回调中可以添加或者取消定时器
+        try {
+            expired.callback();
+        }
+        catch(const std::exception& e) {
+            coap_log_warn("Timer %llu callback threw an exception: %s\n", static_cast<unsigned long long>(expired.id), e.what());
+        }
+        catch(...) {
+            coap_log_warn("Timer %llu callback threw an unknown exception.\n", static_cast<unsigned long long>(expired.id));
+        }
+        if(expired.period > 0) {
+            std::lock_guard<std::mutex> lock(m_timerMutex);
+            m_timers->rearm(std::move(expired));
+        }
+    }
+}
+
+uint32_t Context::clampWaitToTimers(uint32_t waitMs) noexcept
+{
+    if(waitMs == COAP_IO_NO_WAIT)
+        return waitMs;
+    std::optional<uint64_t> next;
+    uint64_t now;
+    {
+        std::lock_guard<std::mutex> lock(m_timerMutex);
+        next = m_timers->nextExpire();
+        now = m_clock->nowMs();
+    }
+    if(next.has_value() == false)
+        return waitMs;
+    // 还有已经到期但没有执行的定时器，不能等待
+    if(next.value() <= now)
+        return COAP_IO_NO_WAIT;
+    auto left = std::min<uint64_t>(next.value() - now, UINT32_MAX - 1);
+    if(waitMs == COAP_IO_WAIT || left < waitMs)
+        return static_cast<uint32_t>(left);
+    return waitMs;
+}
+
+Context::BusyPollStats Context::getBusyPollStats() const noexcept
+{
+    BusyPollStats stats;
+    stats.spinUs = m_busyPollSpinUs.load(std::memory_order_relaxed);
+    stats.sleepUs = m_busyPollSleepUs.load(std::memory_order_relaxed);
+    stats.spinPolls = m_busyPollSpinPolls.load(std::memory_order_relaxed);
+    stats.spinHits = m_busyPollSpinHits.load(std::memory_order_relaxed);
+    stats.sleeps = m_busyPollSleeps.load(std::memory_order_relaxed);
+    return stats;
+}
+
+uint64_t Context::nowMs() const noexcept
+{
+    // 与setClock()使用同一个锁，更换时钟时不会读到已经释放的时钟
+    std::lock_guard<std::mutex> lock(m_timerMutex);
+    return m_clock->nowMs();
+}
+
+void Context::applyIOThreadOptions(const IOThreadOptions& options) noexcept
+{
+#ifdef __linux__
+    if(options.cpuAffinity.empty() == false) {
+        cpu_set_t cpus;
+        CPU_ZERO(&cpus);
+        for(auto cpu : options.cpuAffinity) {
+            if(cpu >= 0 && cpu < CPU_SETSIZE)
+                CPU_SET(cpu, &cpus);
+        }
+        auto result = pthread_setaffinity_np(pthread_self(), sizeof(cpus), &cpus);
+        if(result != 0)
+            coap_log_warn("Failed to set the CPU affinity of the I/O thread: %s\n", std::strerror(result));
+    }
+    if(options.realtimePriority > 0) {
+        sched_param param = {};
+        param.sched_priority = options.realtimePriority;
+        auto result = pthread_setschedparam(pthread_self(), SCHED_FIFO, &param);
+        if(result != 0)
+            coap_log_warn("Failed to set SCHED_FIFO priority %d for the I/O thread: %s\n", options.realtimePriority, std::strerror(result));
+    }
+    else if(options.nice != 0) {
+        // Linux上nice值是线程级别的，用线程id设置只影响I/O线程
+        if(setpriority(PRIO_PROCESS, static_cast<id_t>(syscall(SYS_gettid)), options.nice) != 0)
+            coap_log_warn("Failed to set nice %d for the I/O thread: %s\n", options.nice, std::strerror(errno));
+    }
+    if(options.lockMemory) {
+        if(mlockall(MCL_CURRENT | MCL_FUTURE) != 0)
+            coap_log_warn("mlockall() failed: %s\n", std::strerror(errno));
+    }
+#else
+    if(options.cpuAffinity.empty() == false || options.realtimePriority > 0 || options.nice != 0 || options.lockMemory)
+        coap_log_warn("I/O thread options are only supported on Linux.\n");
+#endif
+}
+
+void Context::waitForIdle() const noexcept
+{
+    std::unique_lock<std::mutex> lock(m_idleMutex);
+    m_idleCond.wait(lock, [this]() { return m_isBusy == false; });
+}
+
+void Context::shutdownIOProcess() noexcept
+{
+    m_shutdown = true;
+    // 与IOHub::addContext()使用同一个锁读取并清除，调用removeContext()时不能持有，否则与集线器的加锁顺序相反
+    IOHub* hub;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        hub = std::exchange(m_ioHub, nullptr);
+    }
+    if(hub)
+        hub->removeContext(*this);
+    stopIOProcess();
+    waitForIdle();
+}
+
+bool Context::enterIOProcess() noexcept
+{
+    // 先标记忙碌再检查关闭标志，与shutdownIOProcess()先设置关闭标志再等待空闲相对应，
+    // 两者都使用顺序一致的原子操作，保证要么这里看到关闭标志，要么关闭方看到忙碌状态
+    if(m_isBusy.exchange(true))
+        return false;
+    if(m_shutdown) {
+        leaveIOProcess();
+        return false;
+    }
+    m_busyThreadId = std::this_thread::get_id();
+    return true;
+}
+
+bool Context::waitToEnterIOProcess() noexcept
+{
+    if(m_shutdown)
+        return false;
+    // 启动线程前刚好进入的外部ioProcess()，等它结束后再继续，不能让I/O线程悄悄退出
+    waitForIdle();
+    return m_shutdown == false;
+}
+
+void Context::leaveIOProcess() noexcept
+{
+    // 在锁内清除忙碌标志并通知：析构中的waitForIdle()要等这里释放锁后才能返回，
+    // 之后进行网络I/O的线程不会再访问Context的任何成员
+    std::lock_guard<std::mutex> lock(m_idleMutex);
+    m_busyThreadId = std::thread::id();
+    m_isBusy = false;
+    m_idleCond.notify_all();
+}
+
+void Context::checkExternalIO() const
+{
+    if(isReady() == false)
+        throw DataNotReadyException("No endpoint or session added, no network I/O possible.");
+    if(getFileDescriptor() < 0)
+        throw InternalException("libcoap does not support epoll, unable to use an external event loop.");
+    if(isIOProcessRunning())
+        throw InternalException("The I/O thread is running, external I/O processing is not allowed.");
+}
+
+void Context::wakeupInit() noexcept
+{
+#ifdef __linux__
+    m_wakeupFd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if(m_wakeupFd < 0) {
+        coap_log_warn("eventfd() failed, wakeup() is not available.\n");
+        return;
+    }
+    if(coap_epoll_is_supported()) {
+        // epoll模式下，把唤醒描述符加入libcoap的epoll集合。
+        // data.ptr为空的事件会被coap_io_do_epoll忽略，只用来让epoll_wait返回
+        struct epoll_event event = {};
+        event.events = EPOLLIN | EPOLLET;
+        event.data.ptr = nullptr;
+        if(epoll_ctl(coap_context_get_coap_fd(m_ctx), EPOLL_CTL_ADD, m_wakeupFd, &event) < 0) {
+            coap_log_warn("epoll_ctl() failed, wakeup() is not available.\n");
+            ::close(m_wakeupFd);
+            m_wakeupFd = -1;
+        }
+    }
+#endif
+}
+
+void Context::wakeupDrain() noexcept
+{
+#ifdef __linux__
+    if(m_wakeupFd >= 0) {
+        uint64_t count;
+        auto n = ::read(m_wakeupFd, &count, sizeof(count));
+        (void)n; // 没有被唤醒时返回EAGAIN
+    }
+#endif
+}
 
 };// namespace CoapPlusPlus 
\ No newline at end of file
@@ -12,37 +12,119 @@
 
 #include <thread>
 #include <mutex>
+#include <condition_variable>
+#include <atomic>
 #include <memory>
 #include <functional>
+#include <vector>
 
 struct coap_context_t;
 namespace CoapPlusPlus {
 
 class EventHandling;
+class TimerWheel;
+class Clock;
+class IOHub;
 class Context 
 {
     friend class EventHandling;
+    friend class IOHub;
     Context& operator=(const Context&) = delete;
     Context& operator=(Context&&) = delete;
     Context(const Context&) = delete;
     Context(Context&&) = delete;
 public:
-    // /**
-    //  * @brief 开始悬而未决的网络I/O，然后选择性地等待下一个输入数据包。
-    //  * 
-    //  * 
-    //  * @param waitMs 在做完任何处理后返回前等待新数据包的最小毫秒数。
-    //  *               如果为0，该调用将阻塞到下一个内部动作（如数据包重传）（如果有），或阻塞到收到下一个数据包（以较早者为准），并做必要的处理。
-    //  *               如果为-1，该函数将在处理后立即返回，而不等待任何新的输入数据包到达。
-    //  * @return 开始IO处理，成功返回true，否则返回false
-    //  */
-    // bool startIOProcess(int waitMs = 1000) noexcept;
-
-    // /**
-    //  * @brief 停止阻塞当前的Coap I/O 处理
-    //  * 
-    //  */
-    // void stopIOProcess() noexcept;
+    using TimerId = uint64_t;
+
+    /**
+     * @brief I/O线程的运行配置，用于把网络I/O的热循环与同一进程中的其他线程隔离
+     * 
+     * @note 目前仅在Linux上生效。设置失败(通常是权限不足)只会记录警告，I/O线程仍然会运行
+     */
+    struct IOThreadOptions {
+        /// 绑定的CPU编号，为空表示不绑定
+        std::vector<int> cpuAffinity;
+        /// SCHED_FIFO实时调度的优先级(1~99)，为0表示使用普通的分时调度，需要CAP_SYS_NICE权限
+        int realtimePriority = 0;
+        /// 普通分时调度下线程的nice值(-20~19)，只在realtimePriority为0时生效，小于0需要CAP_SYS_NICE权限
+        int nice = 0;
+        /// 是否锁定进程的全部内存(mlockall)，避免缺页带来的延迟，作用于整个进程且不会在线程停止后解除
+        bool lockMemory = false;
+        /// 忙轮询的窗口(微秒)，为0表示不忙轮询。大于0时每次收到数据报后的这段时间内不等待地轮询，
+        /// 之后退回到阻塞等待，阻塞时间从1毫秒开始按指数增长。需要libcoap支持epoll，否则会被忽略
+        int busyPollUs = 0;
+    };
+
+    /**
+     * @brief 忙轮询的统计信息 @see IOThreadOptions::busyPollUs
+     * 
+     */
+    struct BusyPollStats {
+        uint64_t spinUs = 0;        // 忙轮询阶段花费的微秒数
+        uint64_t sleepUs = 0;       // 阻塞等待阶段花费的微秒数
+        uint64_t spinPolls = 0;     // 忙轮询的次数
+        uint64_t spinHits = 0;      // 忙轮询中收到数据报的次数
+        uint64_t sleeps = 0;        // 阻塞等待的次数
+    };
+
+    /**
+     * @brief 启动一个由Context管理的I/O线程，在该线程中循环进行网络I/O处理
+     * 
+     * @param waitMs 每次I/O处理等待新数据包的毫秒数，含义同ioProcess(int waitMs)。
+     *               如果大于0，线程会扣除上一次处理已花费的时间，保证每waitMs毫秒至少返回一次。
+     * @return 是否启动成功
+     *      @retval true 启动成功
+     *      @retval false 没有添加endpoint或者session，I/O线程已经在运行，其他线程正在调用ioProcess()，或者已经加入了IOHub
+     * 
+     * @note I/O线程运行期间不能再调用ioProcess()，停止线程请调用stopIOProcess()。
+     *       启动时恰好有其他线程进入了ioProcess()，I/O线程会等待它结束后再开始处理，不会退出
+     */
+    bool startIOProcess(int waitMs = 1000) noexcept;
+
+    /**
+     * @brief 设置I/O线程的运行配置，在下一次startIOProcess()启动的线程中生效
+     * 
+     * @param options 运行配置
+     */
+    void setIOThreadOptions(const IOThreadOptions& options) noexcept;
+
+    /**
+     * @brief 获取I/O线程的运行配置
+     * 
+     */
+    IOThreadOptions getIOThreadOptions() const noexcept;
+
+    /**
+     * @brief 停止I/O线程，函数返回时I/O线程已经退出
+     * @details 在I/O线程自己的回调中调用时只通知线程退出，不等待，线程在本次回调返回后退出，
+     *          由下一次startIOProcess()、stopIOProcess()或者析构回收。
+     * 
+     * @note 不支持唤醒的平台上，为了能及时停止，I/O线程每次最多阻塞100毫秒，所以该函数最多等待100毫秒
+     * @see wakeup()
+     */
+    void stopIOProcess() noexcept;
+
+    /**
+     * @brief I/O线程是否正在运行
+     * 
+     * @return true 正在运行
+     * @return false 没有运行
+     */
+    bool isIOProcessRunning() const noexcept { return m_running; }
+
+    /**
+     * @brief 获取I/O线程忙轮询的统计信息，可以在任意线程中调用，每次启动I/O线程时清零
+     * @details 用spinUs与sleepUs的比例衡量用CPU换取的延迟，spinHits与spinPolls的比例衡量忙轮询的命中率。
+     * 
+     */
+    BusyPollStats getBusyPollStats() const noexcept;
+
+    /**
+     * @brief 注册一个I/O处理的观察函数，I/O线程每完成一次I/O处理后调用该函数，如果要取消注册，可以将参数设置为nullptr
+     * 
+     * @param observer 观察函数，参数为本次I/O处理花费的毫秒数，在I/O线程中被调用
+     */
+    void registerIOProcessObserver(std::function<void(int)> observer) noexcept;
 
     /**
      * @brief 注册一个事件处理器，用于处理Coap事件, 如果要取消注册，可以将参数设置为nullptr
@@ -60,9 +142,102 @@ public:
      * @return 返回在函数中花费的毫秒数；如果出现错误，则返回 -1。 
      * 
      * @exception DataNotReadyException 数据未准备好，无法进行网络I
+     * @note I/O线程运行期间调用该函数会直接返回-1
      */
     int ioProcess(int waitMs = 1000);
 
+    /**
+     * @brief 获取Context进行网络I/O所等待的文件描述符，用于把Context接入外部的事件循环(如epoll)
+     * @details 该描述符是libcoap内部的epoll描述符，Context的所有套接字、定时器以及唤醒描述符都注册在其中，
+     *          只要其中任意一个就绪，该描述符就会变为可读。
+     * 
+     * @return 文件描述符，libcoap不支持epoll时返回-1
+     * @see prepareIO() processIO()
+     */
+    int getFileDescriptor() const noexcept;
+
+    /**
+     * @brief 外部事件循环等待getFileDescriptor()之前调用，发送待发的数据并计算下一个内部定时事件(如重传)的等待时间
+     * 
+     * @return 等待的毫秒数，可以直接作为epoll_wait的超时参数，-1表示没有定时事件
+     * 
+     * @exception DataNotReadyException 数据未准备好，无法进行网络I/O
+     * @exception InternalException libcoap不支持epoll或者I/O线程正在运行
+     */
+    int prepareIO();
+
+    /**
+     * @brief 外部事件循环发现getFileDescriptor()可读或者等待超时后调用，非阻塞地处理已经就绪的网络I/O
+     * 
+     * @exception DataNotReadyException 数据未准备好，无法进行网络I/O
+     * @exception InternalException libcoap不支持epoll或者I/O线程正在运行
+     * 
+     * @code {.cpp}
+     * int epfd = epoll_create1(0);
+     * epoll_event ev = { EPOLLIN, { .ptr = &context } };
+     * epoll_ctl(epfd, EPOLL_CTL_ADD, context.getFileDescriptor(), &ev);
+     * while(running) {
+     *     auto timeout = context.prepareIO();
+     *     epoll_wait(epfd, events, maxEvents, timeout);
+     *     ... 处理其他协议的事件 ...
+     *     context.processIO();
+     * }
+     * @endcode
+     */
+    void processIO();
+
+    /**
+     * @brief 唤醒阻塞在ioProcess()或者I/O线程中的网络I/O等待，可以在任意线程中调用
+     * @details 唤醒后排队中的请求和观察通知会立刻被发送，而不需要等到下一个数据包或者重传定时器。
+     * 
+     * @note 目前仅在Linux上通过eventfd实现，其他平台上该函数不做任何事情
+     */
+    void wakeup() noexcept;
+
+    /**
+     * @brief 设置Context使用的时钟，定时器以及其他依赖时间的功能都从该时钟获取当前时间，默认使用SteadyClock
+     * 
+     * @param clock 时钟，生命周期将由class Context管理，为nullptr时恢复默认时钟 @see ManualClock
+     * @return 是否设置成功
+     *      @retval false I/O线程正在运行、已经加入IOHub或者其他线程正在进行网络I/O，
+     *                    或者还有未到期的定时器，此时更换时钟会导致已有的到期时间失去意义
+     * 
+     * @note libcoap内部的重传、会话超时等仍然使用系统时间，不受该时钟影响
+     */
+    bool setClock(std::unique_ptr<Clock> clock) noexcept;
+
+    /**
+     * @brief 获取Context使用的时钟
+     * 
+     * @note 返回的引用在下一次setClock()成功之前有效
+     */
+    const Clock& getClock() const noexcept { return *m_clock; }
+
+    /**
+     * @brief 添加一个定时器，回调函数在进行网络I/O的线程中执行，可以在任意线程中调用
+     * @details 定时器的到期时间会参与网络I/O等待时间的计算，等待会在最近的定时器到期时结束，
+     *          所以在回调中调用Resource::notifyObserver()等操作不需要额外的线程。
+     * 
+     * @param delayMs 第一次触发前等待的毫秒数，小于0按0处理
+     * @param callback 回调函数，不能阻塞，抛出的异常会被记录后忽略
+     * @param periodMs 触发周期的毫秒数，小于等于0表示只触发一次
+     * @return 定时器的id，用于cancelTimer()
+     * 
+     * @note 回调函数中可以添加或者取消定时器，包括取消自身
+     */
+    TimerId addTimer(int delayMs, std::function<void()> callback, int periodMs = 0);
+
+    /**
+     * @brief 取消一个定时器，可以在任意线程中调用
+     * 
+     * @param id addTimer()返回的定时器id
+     * @return 是否取消成功
+     *      @retval false 定时器不存在或者一次性定时器已经触发
+     * 
+     * @note 在其他线程中调用时，如果回调函数正在执行，该函数不会等待其结束
+     */
+    bool cancelTimer(TimerId id) noexcept;
+
     /**
      * @brief 检查是否有任何 I/O 待处理。
      * 
@@ -71,6 +246,12 @@ public:
      */
     bool isioPending() const noexcept;
 
+    /**
+     * @brief 是否已经加入了IOHub，由集线器的线程进行网络I/O @see IOHub
+     * 
+     */
+    bool isInIOHub() const noexcept;
+
     /**
      * @brief 是否正在进行网络I/O
      * 
@@ -79,6 +260,18 @@ public:
      */
     bool isBusy() const noexcept { return m_isBusy; }
 
+    /**
+     * @brief 当前线程是否正在进行该上下文的网络I/O，例如在定时器、资源或者事件的回调中
+     * 
+     */
+    bool isInIOProcess() const noexcept { return m_busyThreadId.load() == std::this_thread::get_id(); }
+
+    /**
+     * @brief 阻塞等待当前正在进行的网络I/O结束，等待期间不占用CPU
+     * 
+     */
+    void waitForIdle() const noexcept;
+
 protected:
     /**
      * @brief coap_context_t的C++封装，一个Context对应一个服务器或者一个客户端。
@@ -90,6 +283,13 @@ protected:
     virtual ~Context() noexcept;
     coap_context_t* getContext() const noexcept { return m_ctx; }
 
+    /**
+     * @brief 关闭网络I/O：从IOHub中移除，停止I/O线程，等待正在进行的网络I/O结束，之后所有的网络I/O调用都会失败
+     * 
+     * @note 子类的析构函数在释放资源前必须先调用该函数，否则I/O的回调可能会使用已经释放的资源
+     */
+    void shutdownIOProcess() noexcept;
+
     /**
      * @brief 是否准备好一切以用于网络I/O
      * 
@@ -98,14 +298,79 @@ protected:
      */
     virtual bool isReady() const noexcept = 0;
 
+    /**
+     * @brief 从getClock()获取当前的毫秒时间
+     * 
+     */
+    uint64_t nowMs() const noexcept;
+
+    /**
+     * @brief 每次调用coap_io_process之前，在进行网络I/O的线程中自动调用该函数
+     * 
+     */
+    virtual void beforeIOProcess() noexcept { }
+
+    /**
+     * @brief 每次coap_io_process(或者processIO()中的事件处理)之后，在进行网络I/O的线程中自动调用该函数
+     * 
+     */
+    virtual void afterIOProcess() noexcept { }
+
+    /**
+     * @brief 不等待地连续处理已经就绪的套接字事件，直到没有就绪的事件或者达到上限
+     * @details libcoap每处理一个套接字事件只读取一个数据报，
+     *          突发流量下剩余的数据报要等到下一次网络I/O处理(重新计算定时、执行定时器)才会被读取。
+     *          该函数在一次网络I/O处理之后背靠背地继续读取，只能在进行网络I/O的线程中调用。
+     *          每一轮先调用一次不等待的epoll_wait，再由libcoap逐个recvfrom，省去的只是数据报之间的定时和唤醒处理，不会减少系统调用。
+     * 
+     * @param maxEvents 最多处理的套接字事件数量，每个事件对应一个数据报
+     * @return 实际处理的套接字事件数量，libcoap不支持epoll时返回0
+     */
+    size_t drainReadyIO(size_t maxEvents) noexcept;
+
+private:
+    void ioProcessThreadFunc(int waitMs, IOThreadOptions options) noexcept;
+    void busyPollThreadFunc(uint32_t timeout, int windowUs) noexcept;
+    int pollReadyIO(uint32_t timeoutMs, bool idle) noexcept;
+    void applyIOThreadOptions(const IOThreadOptions& options) noexcept;
+    void joinIOThread() noexcept;
+    bool waitToEnterIOProcess() noexcept;
+    int doIOProcess(uint32_t waitMs) noexcept;
+    bool enterIOProcess() noexcept;
+    void leaveIOProcess() noexcept;
+    void checkExternalIO() const;
+    void wakeupInit() noexcept;
+    void wakeupDrain() noexcept;
+    void runTimers() noexcept;
+    uint32_t clampWaitToTimers(uint32_t waitMs) noexcept;
+
 protected :
     coap_context_t*     m_ctx {};
 
 private:
-    std::thread* m_thread {};
-    std::mutex m_mutex;
-    //bool m_flag = true;
-    bool m_isBusy = false;
+    std::thread* m_thread {};           // 由m_threadMutex保护，等待线程退出时不持有m_mutex
+    std::mutex m_threadMutex;
+    std::atomic<std::thread::id> m_ioThreadId;
+    mutable std::mutex m_mutex;
+    std::atomic<bool> m_running = false;
+    IOThreadOptions m_ioThreadOptions;  // 由m_mutex保护
+    std::mutex m_observerMutex;
+    std::function<void(int)> m_ioProcessObserver;
+    std::atomic<bool> m_isBusy = false;
+    std::atomic<std::thread::id> m_busyThreadId;    // 正在进行网络I/O的线程，与m_isBusy一起设置和清除
+    mutable std::mutex m_idleMutex;         // 与m_idleCond一起用于等待m_isBusy被清除
+    mutable std::condition_variable m_idleCond;
+    std::atomic<uint64_t> m_busyPollSpinUs = 0;
+    std::atomic<uint64_t> m_busyPollSleepUs = 0;
+    std::atomic<uint64_t> m_busyPollSpinPolls = 0;
+    std::atomic<uint64_t> m_busyPollSpinHits = 0;
+    std::atomic<uint64_t> m_busyPollSleeps = 0;
+    std::atomic<bool> m_shutdown = false;
+    int m_wakeupFd = -1;
+    mutable std::mutex m_timerMutex;    // 同时保护m_timers和m_clock
+    TimerWheel* m_timers {};
+    Clock* m_clock {};
+    IOHub* m_ioHub {};  // 由m_mutex保护，IOHub持有自己的锁时再获取m_mutex设置和清除
 
 private: 
     EventHandling* m_eventHandling = nullptr;
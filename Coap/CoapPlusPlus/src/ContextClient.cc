@@ -1,38 +1,72 @@
 #include <coap3/coap.h>
 #include "ContextClient.h"
 #include "coap/Session.h"
+#include "coap/DataStruct/Address.h"
 #include "coap/exception.h"
 #include "coap/Pdu/ResponsePdu.h"
+#include "coap/Pdu/RequestPdu.h"
+#include "coap/SendersManager.h"
+#include "coap/Handling.h"
+#include "coap/Response.h"
+#include "utils/MpscQueue.h"
+#include <optional>
 
 namespace CoapPlusPlus
 {
 
-std::function<void(const Session*, const ResponsePdu*, int)> ContextClient::HandsharkeResponedFunction;
+// 每次网络I/O处理前最多发送的提交请求数量，剩余的请求留到下一次处理
+static constexpr int SUBMIT_BATCH_SIZE = 64;
+
+struct ContextClient::SendCommand
+{
+    SessionKey key;
+    Information::MessageType type = Information::Confirmable;
+    Information::RequestCode code = Information::Get;
+    RequestBuilder builder;                         // 在进行网络I/O的线程中创建请求后调用
+    std::optional<std::promise<Response>> promise;  // submitFuture()提交的请求，结果写入promise
+    int timeoutMs = 0;
+};
+
+// 请求没有被发送时也要给等待者一个结果
+static void AbandonCommand(std::optional<std::promise<Response>>& promise) noexcept
+try{
+    if(promise)
+        promise->set_value(Response(Response::NAck, Handling::NotDelivered));
+}catch(std::exception& e) {
+    coap_log_warn("submit: %s\n", e.what());
+}
+
+// 健康探测中会话的标识，由端口号和协议组成
+static HealthProbe::PeerId PeerIdOf(uint16_t port, Information::Protocol pro) noexcept
+{
+    return (static_cast<HealthProbe::PeerId>(pro) << 16) | port;
+}
 
 ContextClient::ContextClient() : Context()
 {
+    m_submitQueue = new MpscQueue<SendCommand>();
+    coap_register_pong_handler(m_ctx, PongHandler);
 }
 
 ContextClient::~ContextClient() noexcept
 {
-    while(isBusy());///必须先停止IO进程，否则会导致资源已经被释放，但是IO进程的回调还在使用资源
+    shutdownIOProcess();///必须先停止IO进程，否则会导致资源已经被释放，但是IO进程的回调还在使用资源
     // 删除所有会话对象
     for (auto& pair : m_sessions) {
         delete pair.second;
     }
     m_sessions.clear();
+    // 未发送的请求随队列一起销毁
+    while(auto command = m_submitQueue->pop())
+        AbandonCommand(command->promise);
+    delete m_submitQueue;
+    m_submitQueue = nullptr;
 }
 
-void ContextClient::registerHandshakeResponedFunction(std::function<void(const Session*, const ResponsePdu*, int)> handler) noexcept
+void ContextClient::registerHandshakeResponedFunction(std::function<void(const SessionView*, const ResponsePdu*, int)> handler) noexcept
 {
-    HandsharkeResponedFunction = handler;
-    coap_register_pong_handler(m_ctx, [](coap_session_t* session, const coap_pdu_t* received, const coap_mid_t id) {
-        if(HandsharkeResponedFunction) {
-            auto s = Session(session, false);
-            auto r = ResponsePdu(const_cast<coap_pdu_t*>(received));
-            HandsharkeResponedFunction(&s, &r, id);
-        }
-    });
+    std::lock_guard<std::mutex> lock(m_handshakeMutex);
+    m_handshakeFunction = std::move(handler);
 }
 
 void ContextClient::setHandshakeInterval(unsigned int seconds) noexcept
@@ -42,6 +76,11 @@ void ContextClient::setHandshakeInterval(unsigned int seconds) noexcept
 
 bool ContextClient::addSession(uint16_t port, Information::Protocol pro) noexcept
 {
+    // 进行网络I/O的线程会遍历会话表
+    if(isIOProcessRunning() || isInIOHub() || isBusy()) {
+        coap_log_warn("addSession: network I/O is driven by another thread.\n");
+        return false;
+    }
     // 检查会话是否已存在
     if (m_sessions.find({ port, pro }) != m_sessions.end()) {
         return false; 
@@ -61,6 +100,11 @@ bool ContextClient::addSession(uint16_t port, Information::Protocol pro) noexcep
 
 bool ContextClient::removeSession(uint16_t port, Information::Protocol pro) noexcept
 {
+    // 进行网络I/O的线程会遍历会话表并使用会话的SendersManager
+    if(isIOProcessRunning() || isInIOHub() || isBusy()) {
+        coap_log_warn("removeSession: network I/O is driven by another thread.\n");
+        return false;
+    }
     // 检查会话是否存在
     auto it = m_sessions.find({ port, pro });
     if (it == m_sessions.end()) {
@@ -70,6 +114,8 @@ bool ContextClient::removeSession(uint16_t port, Information::Protocol pro) noex
     // 删除并释放会话对象
     delete it->second;
     m_sessions.erase(it);
+    if(auto probe = getHealthProbe())
+        probe->removePeer(PeerIdOf(port, pro));
     return true;
 }
 
@@ -85,11 +131,182 @@ Session* ContextClient::getSession(uint16_t port, Information::Protocol pro) con
     return it->second;
 }
 
+void ContextClient::submit(uint16_t port, Information::Protocol pro, Information::MessageType type, Information::RequestCode code,
+                           RequestBuilder builder) noexcept
+try{
+    m_submitQueue->push(SendCommand{ { port, pro }, type, code, std::move(builder) });
+    wakeup();
+}catch(std::exception& e) {
+    coap_log_warn("submit: %s\n", e.what());
+}
+
+std::future<Response> ContextClient::submitFuture(uint16_t port, Information::Protocol pro, Information::MessageType type, Information::RequestCode code,
+                                                 std::function<void(RequestPdu& pdu)> builder, int timeoutMs)
+{
+    std::promise<Response> promise;
+    auto future = promise.get_future();
+    RequestBuilder requestBuilder;
+    if(builder) {
+        requestBuilder = [builder = std::move(builder)](RequestPdu& pdu) -> std::unique_ptr<Handling> {
+            builder(pdu);
+            return nullptr;
+        };
+    }
+    m_submitQueue->push(SendCommand{ { port, pro }, type, code, std::move(requestBuilder), std::move(promise), timeoutMs });
+    wakeup();
+    return future;
+}
+
+bool ContextClient::setHealthProbe(int intervalMs, const HealthProbe::Options& options,
+                                   std::function<void(uint16_t, Information::Protocol, bool)> observer) noexcept
+try{
+    // 探测在进行网络I/O的线程中进行，只有没有线程在进行网络I/O时才能重新设置
+    if(isIOProcessRunning() || isInIOHub() || isBusy()) {
+        coap_log_warn("setHealthProbe: network I/O is driven by another thread.\n");
+        return false;
+    }
+    std::shared_ptr<HealthProbe> probe;
+    if(intervalMs > 0) {
+        std::function<void(HealthProbe::PeerId, bool)> peerObserver;
+        if(observer) {
+            peerObserver = [observer = std::move(observer)](HealthProbe::PeerId peer, bool healthy) {
+                observer(static_cast<uint16_t>(peer & 0xFFFF), static_cast<Information::Protocol>(peer >> 16), healthy);
+            };
+        }
+        probe = std::make_shared<HealthProbe>(options, std::move(peerObserver));
+    }
+    if(m_healthProbeTimer != 0) {
+        cancelTimer(m_healthProbeTimer);
+        m_healthProbeTimer = 0;
+    }
+    {
+        std::lock_guard<std::mutex> lock(m_healthProbeMutex);
+        m_healthProbe = probe;
+    }
+    if(probe)
+        m_healthProbeTimer = addTimer(0, [this]() { probeSessions(); }, intervalMs);
+    return true;
+}catch(std::exception& e) {
+    coap_log_warn("setHealthProbe: %s\n", e.what());
+    return false;
+}
+
+std::shared_ptr<HealthProbe> ContextClient::getHealthProbe() const noexcept
+{
+    std::lock_guard<std::mutex> lock(m_healthProbeMutex);
+    return m_healthProbe;
+}
+
+bool ContextClient::getPeerHealth(uint16_t port, Information::Protocol pro, HealthProbe::Health& health) const noexcept
+{
+    auto probe = getHealthProbe();
+    if(probe == nullptr)
+        return false;
+    return probe->getHealth(PeerIdOf(port, pro), health);
+}
+
+std::vector<ContextClient::PeerHealth> ContextClient::getAllPeerHealth() const
+{
+    std::vector<PeerHealth> result;
+    auto probe = getHealthProbe();
+    if(probe == nullptr)
+        return result;
+    auto all = probe->getAllHealth();
+    result.reserve(all.size());
+    for(auto& [peer, health] : all)
+        result.push_back({ static_cast<uint16_t>(peer & 0xFFFF), static_cast<Information::Protocol>(peer >> 16), health });
+    return result;
+}
+
+void ContextClient::probeSessions() noexcept
+{
+    auto probe = getHealthProbe();
+    if(probe == nullptr)
+        return;
+    auto now = nowMs();
+    probe->expire(now);
+    for(auto& [key, session] : m_sessions) {
+        auto peer = PeerIdOf(key.first, key.second);
+        if(probe->isProbing(peer))
+            continue;
+        // 发送失败时mid无效，不会有匹配的pong，超时后记为丢失
+        auto mid = coap_session_send_ping(session->m_session);
+        probe->onSent(peer, mid, now);
+    }
+}
+
+void ContextClient::PongHandler(coap_session_t* session, const coap_pdu_t* received, const int id) noexcept
+try{
+    auto context = static_cast<Context*>(coap_get_app_data(coap_session_get_context(session)));
+    auto client = static_cast<ContextClient*>(context);
+    if(client == nullptr)
+        return;
+    auto s = SessionView(session);
+    if(auto probe = client->getHealthProbe())
+        probe->onPong(PeerIdOf(s.getRemoteAddress().getPort(), s.getProtocol()), id, client->nowMs());
+
+    std::function<void(const SessionView*, const ResponsePdu*, int)> handler;
+    {
+        std::lock_guard<std::mutex> lock(client->m_handshakeMutex);
+        handler = client->m_handshakeFunction;
+    }
+    if(handler) {
+        auto r = ResponsePdu(const_cast<coap_pdu_t*>(received));
+        handler(&s, &r, id);
+    }
+}catch(std::exception& e) {
+    coap_log_warn("PongHandler: %s\n", e.what());
+}
+
 bool ContextClient::isReady() const noexcept
 {
     return m_sessions.size() > 0;
 }
 
+void ContextClient::beforeIOProcess() noexcept
+{
+    for(int i = 0; i < SUBMIT_BATCH_SIZE; i++) {
+        auto command = m_submitQueue->pop();
+        if(command.has_value() == false)
+            return;
+        auto it = m_sessions.find(command->key);
+        if(it == m_sessions.end()) {
+            coap_log_warn("submit: session with port %d and protocol %d does not exist\n", 
+                            command->key.first, command->key.second);
+            AbandonCommand(command->promise);
+            continue;
+        }
+        // promise交给SendersManager之后由它负责给出结果
+        bool handedOver = false;
+        try {
+            // 马上就要进行网络I/O处理，不需要再唤醒
+            auto& manager = it->second->getSendersManager();
+            auto pdu = manager.createRequest(command->type, command->code);
+            std::unique_ptr<Handling> handling;
+            if(command->builder)
+                handling = command->builder(pdu);
+            bool sent;
+            if(command->promise) {
+                handedOver = true;
+                sent = manager.sendPromise(std::move(pdu), std::move(*command->promise), command->timeoutMs);
+            }
+            else {
+                sent = manager.sendWithoutWakeup(std::move(pdu), std::move(handling));
+            }
+            if(sent == false)
+                coap_log_warn("submit: send failed\n");
+        }catch(std::exception& e) {
+            coap_log_warn("submit: %s\n", e.what());
+            // 创建请求或者builder失败，等待者还没有结果
+            if(handedOver == false)
+                AbandonCommand(command->promise);
+        }
+    }
+    // 还有剩余的请求，不要让这一次网络I/O阻塞
+    if(m_submitQueue->empty() == false)
+        wakeup();
+}
+
 coap_session_t *ContextClient::createSession(uint16_t port, Information::Protocol pro)
 {
     coap_address_t  addr;
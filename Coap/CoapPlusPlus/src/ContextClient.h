@@ -13,18 +13,26 @@
 
 #include "Context.h"
 #include "coap/Information/GeneralInformation.h"
+#include "coap/Information/PduInformation.h"
+#include "utils/HealthProbe.h"
 
+#include <future>
 #include <map>
 #include <cstdint>
 
 struct coap_session_t;
+struct coap_pdu_t;
 namespace CoapPlusPlus
 {
 class Session;
+class SessionView;
 class ResponsePdu;
+class RequestPdu;
+class Handling;
+class Response;
+template<typename T> class MpscQueue;
 class ContextClient : public Context
 {
-    static std::function<void(const Session*, const ResponsePdu*, int)> HandsharkeResponedFunction;
 public:
     /**
      * @brief 构造一个管理客户端相关信息的Context对象
@@ -37,11 +45,11 @@ public:
     ~ContextClient() noexcept;
 
     /**
-     * @brief 注册一个与服务器握手响应处理函数，用于处理握手响应
+     * @brief 注册一个与服务器握手响应处理函数，用于处理握手响应，每个ContextClient有各自的处理函数
      * 
-     * @param handler 
+     * @param handler 处理函数，在进行网络I/O的线程中被调用，参数为会话、pong报文和消息id
      */
-    void registerHandshakeResponedFunction(std::function<void(const Session*, const ResponsePdu*, int)> handler) noexcept;
+    void registerHandshakeResponedFunction(std::function<void(const SessionView*, const ResponsePdu*, int)> handler) noexcept;
 
     /**
      * @brief 设置握手间隔时间，如果会话在给定的秒数内处于非活动状态（即没有发送或接收数据包），则将保持握手。
@@ -57,10 +65,10 @@ public:
      * @param pro 使用的协议，默认为UDP
      * 
      * @return 是否添加成功
-     *      @retval false 已经存在该会话或者内部错误
+     *      @retval false 已经存在该会话、内部错误，或者I/O线程正在运行、已经加入IOHub、其他线程正在进行网络I/O
      *      @retval true 添加成功
      * 
-     * @note 目前仅支持本地连接，即服务器地址为localhost
+     * @note 目前仅支持本地连接，即服务器地址为localhost。进行网络I/O的线程会遍历会话，需要在开始网络I/O之前添加
      */
     bool addSession(uint16_t port, Information::Protocol pro = Information::Udp) noexcept;
 
@@ -70,7 +78,9 @@ public:
      * @param port 要移除的会话使用的端口号
      * @param pro 要移除的会话使用的协议
      * 
-     * @return 是否移除成功，如果不存在该会话则移除失败
+     * @return 是否移除成功，如果不存在该会话，或者I/O线程正在运行、已经加入IOHub、其他线程正在进行网络I/O则移除失败
+     * 
+     * @note 移除会释放会话及其SendersManager，需要在停止网络I/O之后移除
      */
     bool removeSession(uint16_t port, Information::Protocol pro) noexcept;
 
@@ -86,6 +96,50 @@ public:
      */
     Session* getSession(uint16_t port, Information::Protocol pro) const;
 
+    /**
+     * @brief 构造提交的请求的函数，参数为在进行网络I/O的线程中创建好的请求，返回回应的处理器
+     * @details 函数可以设置请求的选项和payload，返回的处理器可以用请求的token构造，返回空表示使用默认处理器
+     * 
+     */
+    using RequestBuilder = std::function<std::unique_ptr<Handling>(RequestPdu& pdu)>;
+
+    /**
+     * @brief 提交一个请求，可以在任意线程中调用
+     * @details 请求会先进入一个无锁队列，进行网络I/O的线程在下一次网络I/O处理前批量取出，
+     *          创建请求和token，调用builder设置请求，再调用SendersManager::send()发送。
+     *          创建PDU和token需要访问会话，只能在进行网络I/O的线程中进行，因此提交的是构造请求的函数而不是请求本身，
+     *          多个线程同时提交请求时不需要额外的锁。
+     * 
+     * @param port 发送请求使用的会话的端口号
+     * @param pro 发送请求使用的会话的协议
+     * @param type 请求的消息类型
+     * @param code 请求码
+     * @param builder 构造请求和回应的处理器的函数，在进行网络I/O的线程中被调用，可以为空
+     * @see SendersManager::send(RequestPdu pdu, std::unique_ptr<Handling> handling)
+     * 
+     * @note 会话不存在、builder抛出异常或者发送失败时只会记录日志，会话不存在时builder不会被调用
+     */
+    void submit(uint16_t port, Information::Protocol pro, Information::MessageType type, Information::RequestCode code,
+                RequestBuilder builder) noexcept;
+
+    /**
+     * @brief 提交一个请求并通过std::future得到结果，可以在任意线程中调用
+     * @details 与submit()一样，请求和token在进行网络I/O的线程中创建，再调用builder设置请求
+     * 
+     * @param port 发送请求使用的会话的端口号
+     * @param pro 发送请求使用的会话的协议
+     * @param type 请求的消息类型
+     * @param code 请求码
+     * @param builder 设置请求的选项和payload的函数，在进行网络I/O的线程中被调用，可以为空
+     * @param timeoutMs 等待响应的期限，含义同SendersManager::sendFuture()，从请求被发送时开始计算
+     * @return 请求的结果，会话不存在、builder抛出异常或者发送失败时为NAck
+     * @see SendersManager::sendFuture(RequestPdu pdu, int timeoutMs)
+     * 
+     * @note 不要在进行网络I/O的线程中等待返回的future，否则请求永远不会被发送
+     */
+    std::future<Response> submitFuture(uint16_t port, Information::Protocol pro, Information::MessageType type, Information::RequestCode code,
+                                       std::function<void(RequestPdu& pdu)> builder = nullptr, int timeoutMs = 0);
+
     /**
      * @brief 得到当前Context中的所有会话数量
      * 
@@ -93,8 +147,57 @@ public:
      */
     size_t getSessionCount() const noexcept { return m_sessions.size(); }
 
+    /**
+     * @brief 一个会话的健康状况 @see setHealthProbe()
+     * 
+     */
+    struct PeerHealth {
+        uint16_t port = 0;
+        Information::Protocol protocol = Information::Udp;
+        HealthProbe::Health health;
+    };
+
+    /**
+     * @brief 设置会话的健康探测，默认不探测
+     * @details 每intervalMs毫秒向所有没有未应答ping的会话同时发送一个CoAP ping，不等待彼此的pong；
+     *          收到pong时记录往返时间并计算平滑往返时间，超时未应答记为丢失，
+     *          连续丢失或者平滑往返时间过大的会话被标记为不健康 @see HealthProbe
+     *          可以据此把请求路由到延迟最低的健康服务器。
+     * 
+     * @param intervalMs 探测间隔的毫秒数，小于等于0表示停止探测并清空记录
+     * @param options 探测配置，timeoutMs应小于intervalMs，否则超时要等到下一次探测时才被发现
+     * @param observer 会话健康状态变化时调用，参数为会话的端口号、协议和是否健康，在进行网络I/O的线程中被调用
+     * @return 是否设置成功
+     *      @retval false I/O线程正在运行、已经加入了IOHub、其他线程正在进行网络I/O，或者探测配置无效
+     * 
+     * @note 重新设置会清空所有记录。UDP会话的ping是一个空的CON报文，服务器以RST应答，
+     *       与setHandshakeInterval()的保活互不影响，注册的握手响应处理函数同样会收到探测的pong。
+     */
+    bool setHealthProbe(int intervalMs, const HealthProbe::Options& options = {},
+                        std::function<void(uint16_t, Information::Protocol, bool)> observer = nullptr) noexcept;
+
+    /**
+     * @brief 获取一个会话的健康状况，可以在任意线程中调用
+     * 
+     * @param port 会话使用的端口号
+     * @param pro 会话使用的协议
+     * @param health 写入健康状况
+     * @return 是否有该会话的记录，没有启用探测或者还没有探测过该会话时返回false
+     */
+    bool getPeerHealth(uint16_t port, Information::Protocol pro, HealthProbe::Health& health) const noexcept;
+
+    /**
+     * @brief 获取所有探测过的会话的健康状况，按平滑往返时间从小到大排列，不健康的会话排在最后，可以在任意线程中调用
+     * 
+     */
+    std::vector<PeerHealth> getAllPeerHealth() const;
+
 private:
     bool isReady() const noexcept override;
+    void beforeIOProcess() noexcept override;
+    void probeSessions() noexcept;
+    std::shared_ptr<HealthProbe> getHealthProbe() const noexcept;
+    static void PongHandler(coap_session_t* session, const coap_pdu_t* received, const int id) noexcept;
 
     /**
      * @brief 创建一个会话对象
@@ -108,6 +211,15 @@ private:
 private:
     using SessionKey = std::pair<uint16_t, Information::Protocol>;
     std::map<SessionKey, Session*> m_sessions;
+    struct SendCommand;
+    MpscQueue<SendCommand>* m_submitQueue = nullptr;
+
+    std::mutex m_handshakeMutex;
+    std::function<void(const SessionView*, const ResponsePdu*, int)> m_handshakeFunction;  // 由m_handshakeMutex保护
+
+    mutable std::mutex m_healthProbeMutex;
+    std::shared_ptr<HealthProbe> m_healthProbe;     // 由m_healthProbeMutex保护，使用时复制一份，重新设置时不会释放正在使用的探测器
+    TimerId m_healthProbeTimer = 0;
 
 };
 
@@ -12,20 +12,66 @@
 #include "ContextServer.h"
 #include "ResourceManager.h"
 #include "EndPoint.h"
-#include "coap/Session.h"
+#include "Resource.h"
+#include "ResourceInterface.h"
+#include "coap/SessionView.h"
+#include "coap/Pdu/RequestPdu.h"
 #include "coap/Pdu/ResponsePdu.h"
 #include "coap/exception.h"
+#include "utils/ThreadPool.h"
+#include "utils/MpscQueue.h"
+#include "utils/AdmissionController.h"
+#include <algorithm>
+#include <bit>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <future>
+#include <memory>
 
 namespace CoapPlusPlus {
 
-std::function<void(const Session*, const ResponsePdu*, int)> ContextServer::HandsharkeResponedFunction;
+// 排空时每次网络I/O最多阻塞的毫秒数，及时检查是否已经排空
+static constexpr int DRAIN_MAX_BLOCK_MS = 10;
+
+/**
+ * @brief 一个交给工作线程处理的异步请求
+ * @details 请求和响应都是独立的副本，工作线程处理期间不会触碰libcoap的会话和上下文。
+ *          处理完成后由网络I/O的线程触发coap_async_t，libcoap再次调用资源的回调函数时把响应复制到真正的响应中。
+ */
+struct ContextServer::AsyncRequest {
+    Resource* resource = nullptr;
+    ResourceInterface* imp = nullptr;
+    coap_session_t* session = nullptr;      // 持有一个引用，保证处理期间会话不会被释放
+    SessionSnapshot* snapshot = nullptr;    // 工作线程只读取快照，不访问会话
+    coap_async_t* async = nullptr;
+    coap_pdu_t* request = nullptr;
+    coap_pdu_t* response = nullptr;
+    std::string query;
+    std::atomic<bool> finished = false;
+};
 
 ContextServer::ContextServer() : Context() {
     m_resourceManager = new ResourceManager(*this);
+    m_asyncFinished = new MpscQueue<AsyncRequest*>;
+    m_notifyQueue = new MpscQueue<std::string>;
+    coap_register_ping_handler(m_ctx, PingHandler);
 }
 
 ContextServer::~ContextServer() noexcept {
-    while(isBusy());///必须先停止IO进程，否则会导致资源已经被释放，但是IO进程的回调还在使用资源
+    shutdownIOProcess();///必须先停止IO进程，否则会导致资源已经被释放，但是IO进程的回调还在使用资源
+    // 析构期间释放异步请求时不再通知应用
+    m_inFlightObserver = nullptr;
+    // 先等待工作线程处理完已经提交的请求，它们还在使用资源的回应接口
+    delete m_asyncPool;
+    m_asyncPool = nullptr;
+    while(m_asyncFinished->pop().has_value());
+    delete m_asyncFinished;
+    m_asyncFinished = nullptr;
+    delete m_notifyQueue;
+    m_notifyQueue = nullptr;
+    for(auto asyncRequest : std::unordered_set<AsyncRequest*>(m_asyncRequests))
+        freeAsyncRequest(asyncRequest);
     delete m_resourceManager;
     m_resourceManager = nullptr;
     
@@ -64,16 +110,30 @@ void ContextServer::setSessionCloseTimeout(int seconds) noexcept
     coap_context_set_session_timeout(getContext(), seconds);
 }
 
-void ContextServer::registerHandshakeResponedFunction(std::function<void(const Session*, const ResponsePdu*, int)> handler) noexcept
+void ContextServer::registerHandshakeResponedFunction(std::function<void(const SessionView*, const ResponsePdu*, int)> handler) noexcept
 {
-    HandsharkeResponedFunction = handler;
-    coap_register_ping_handler(m_ctx, [](coap_session_t* session, const coap_pdu_t* received, const coap_mid_t id) {
-        if(HandsharkeResponedFunction) {
-            auto s = Session(session, false);
-            auto r = ResponsePdu(const_cast<coap_pdu_t*>(received));
-            HandsharkeResponedFunction(&s, &r, id);
-        }
-    });
+    std::lock_guard<std::mutex> lock(m_handshakeMutex);
+    m_handshakeFunction = std::move(handler);
+}
+
+void ContextServer::PingHandler(coap_session_t* session, const coap_pdu_t* received, const int id) noexcept
+try{
+    auto context = static_cast<Context*>(coap_get_app_data(coap_session_get_context(session)));
+    auto server = static_cast<ContextServer*>(context);
+    if(server == nullptr)
+        return;
+    std::function<void(const SessionView*, const ResponsePdu*, int)> handler;
+    {
+        std::lock_guard<std::mutex> lock(server->m_handshakeMutex);
+        handler = server->m_handshakeFunction;
+    }
+    if(handler) {
+        auto s = SessionView(session);
+        auto r = ResponsePdu(const_cast<coap_pdu_t*>(received));
+        handler(&s, &r, id);
+    }
+}catch(std::exception& e) {
+    coap_log_warn("PingHandler: %s\n", e.what());
 }
 
 bool ContextServer::addEndPoint(uint16_t port, Information::Protocol pro) noexcept {
@@ -142,4 +202,362 @@ bool ContextServer::isReady() const noexcept
     return m_endpoints.size() > 0;
 }
 
+bool ContextServer::setAsyncWorkerCount(size_t count) noexcept
+{
+    if(m_asyncPool != nullptr)
+        return false;
+    m_asyncWorkerCount = count;
+    return true;
+}
+
+bool ContextServer::drain(int timeoutMs) noexcept
+{
+    using namespace std::chrono;
+    // 在网络I/O的回调中调用时，检查排空的定时器要等回调返回才能执行，只会白白等到超时
+    if(isInIOProcess()) {
+        coap_log_warn("ContextServer::drain() is not allowed in the network I/O callbacks.\n");
+        return false;
+    }
+    m_drainRetrySeconds = static_cast<uint32_t>(std::max(1, (timeoutMs + 999) / 1000));
+    m_draining = true;
+    // coap_io_pending()内部也会进行网络I/O，不能与I/O线程同时运行
+    stopIOProcess();
+    if(isReady() == false)
+        return true;
+    auto deadline = steady_clock::now() + milliseconds(timeoutMs);
+    bool firstCheck = true;
+    while(true) {
+        auto left = duration_cast<milliseconds>(deadline - steady_clock::now()).count();
+        if(isInIOHub() || isBusy()) {
+            // 由IOHub或者外部事件循环驱动时，网络I/O留给它们进行，是否排空也在它们的线程中检查
+            if(checkDrainedInIOThread(firstCheck ? 0 : DRAIN_MAX_BLOCK_MS, left))
+                return true;
+            firstCheck = false;
+        }
+        else {
+            if(m_asyncPending == 0 && isioPending() == false)
+                return true;
+            if(left <= 0)
+                break;
+            // 返回-1说明其他线程刚好开始了网络I/O，下一次循环改为在它们的线程中检查
+            ioProcess(static_cast<int>(std::min<int64_t>(left, DRAIN_MAX_BLOCK_MS)));
+        }
+        if(steady_clock::now() >= deadline)
+            break;
+    }
+    coap_log_warn("ContextServer::drain() timed out, %zu asynchronous requests are still pending.\n", m_asyncPending.load());
+    return false;
+}
+
+bool ContextServer::checkDrainedInIOThread(int delayMs, int64_t waitMs) noexcept
+try{
+    // 定时器在进行网络I/O的线程中执行，结果通过共享的promise返回，超时后定时器晚些执行也是安全的
+    auto drained = std::make_shared<std::promise<bool>>();
+    auto future = drained->get_future();
+    auto id = addTimer(delayMs, [this, drained]() {
+        drained->set_value(m_asyncPending == 0 && isioPending() == false);
+    });
+    if(future.wait_for(std::chrono::milliseconds(std::max<int64_t>(waitMs, 0))) != std::future_status::ready) {
+        cancelTimer(id);
+        return false;
+    }
+    return future.get();
+}catch(std::exception& e) {
+    coap_log_warn("ContextServer::drain(): %s\n", e.what());
+    return false;
+}
+
+void ContextServer::rejectRequest(coap_pdu_t* response, Information::ResponseCode code, uint32_t maxAgeSeconds) noexcept
+{
+    coap_pdu_set_code(response, static_cast<coap_pdu_code_t>(code));
+    uint8_t buf[4];
+    coap_add_option(response, COAP_OPTION_MAXAGE, coap_encode_var_safe(buf, sizeof(buf), maxAgeSeconds), buf);
+}
+
+void ContextServer::beforeIOProcess() noexcept
+{
+    // 触发工作线程已经处理完成的请求，libcoap会在本次I/O处理中再次调用资源的回调函数
+    while(auto asyncRequest = m_asyncFinished->pop()) {
+        coap_async_trigger(asyncRequest.value()->async);
+    }
+    // 其他线程请求的观察通知，libcoap会在本次I/O处理中发送
+    while(auto uriPath = m_notifyQueue->pop()) {
+        m_resourceManager->notifyInIOThread(uriPath.value());
+    }
+}
+
+void ContextServer::queueNotification(const std::string& uriPath, bool wake) noexcept
+try{
+    m_notifyQueue->push(uriPath);
+    if(wake)
+        wakeup();
+}catch(std::exception& e) {
+    coap_log_warn("notifyObserver: %s\n", e.what());
+}
+
+void ContextServer::afterIOProcess() noexcept
+{
+    readAhead();
+}
+
+void ContextServer::readAhead() noexcept
+{
+    auto maxReads = m_maxReadsPerIO.load(std::memory_order_relaxed);
+    if(maxReads <= 1)
+        return;
+    // 本次网络I/O处理已经为每个就绪的端点读取了一个数据报
+    uint64_t count = drainReadyIO(maxReads - 1);
+    if(count == 0)
+        return;
+    m_readAheadPasses.fetch_add(1, std::memory_order_relaxed);
+    m_readAheadDatagrams.fetch_add(count, std::memory_order_relaxed);
+    if(count > m_readAheadMaxPerPass.load(std::memory_order_relaxed))
+        m_readAheadMaxPerPass.store(count, std::memory_order_relaxed);   // 只在网络I/O的线程中写入
+    auto bucket = std::min<size_t>(std::bit_width(count) - 1, m_readAheadHistogram.size() - 1);
+    m_readAheadHistogram[bucket].fetch_add(1, std::memory_order_relaxed);
+}
+
+bool ContextServer::setMaxReadsPerIOProcess(size_t count) noexcept
+{
+    if(count > 1 && coap_epoll_is_supported() == 0) {
+        coap_log_warn("libcoap does not support epoll, unable to read ahead.\n");
+        return false;
+    }
+    m_maxReadsPerIO = std::max<size_t>(count, 1);
+    return true;
+}
+
+ContextServer::ReadAheadStats ContextServer::getReadAheadStats() const noexcept
+{
+    ReadAheadStats stats;
+    stats.passes = m_readAheadPasses.load(std::memory_order_relaxed);
+    stats.datagrams = m_readAheadDatagrams.load(std::memory_order_relaxed);
+    stats.maxPerPass = m_readAheadMaxPerPass.load(std::memory_order_relaxed);
+    for(size_t i = 0; i < stats.histogram.size(); i++)
+        stats.histogram[i] = m_readAheadHistogram[i].load(std::memory_order_relaxed);
+    return stats;
+}
+
+bool ContextServer::setRateLimit(double requestsPerSecond, uint32_t burst, bool perResource) noexcept
+try {
+    // 令牌桶在进行网络I/O的线程中使用，只有没有线程在进行网络I/O时才能重新设置
+    if(isIOProcessRunning() || isInIOHub() || isBusy()) {
+        coap_log_warn("setRateLimit: network I/O is driven by another thread.\n");
+        return false;
+    }
+    std::shared_ptr<AdmissionController> admission;
+    if(requestsPerSecond > 0) {
+        if(burst == 0)
+            burst = static_cast<uint32_t>(std::max(1.0, std::ceil(requestsPerSecond)));
+        admission = std::make_shared<AdmissionController>(requestsPerSecond, burst);
+    }
+    std::lock_guard<std::mutex> lock(m_admissionMutex);
+    m_admission = std::move(admission);
+    m_admissionPerResource = perResource;
+    return true;
+}catch(std::exception& e) {
+    coap_log_warn("setRateLimit: %s\n", e.what());
+    return false;
+}
+
+ContextServer::AdmissionStats ContextServer::getAdmissionStats() const noexcept
+{
+    AdmissionStats stats;
+    std::shared_ptr<AdmissionController> admission;
+    {
+        std::lock_guard<std::mutex> lock(m_admissionMutex);
+        admission = m_admission;
+    }
+    if(admission == nullptr)
+        return stats;
+    auto s = admission->getStats();
+    stats.admitted = s.admitted;
+    stats.rejected = s.rejected;
+    stats.tracked = s.tracked;
+    return stats;
+}
+
+bool ContextServer::setInFlightLimit(size_t limit, size_t lowWater, std::function<void(bool, size_t)> observer,
+                                     uint32_t retryAfterSeconds) noexcept
+{
+    // 上限和观察函数在进行网络I/O的线程中使用，只有没有线程在进行网络I/O时才能重新设置
+    if(isIOProcessRunning() || isInIOHub() || isBusy()) {
+        coap_log_warn("setInFlightLimit: network I/O is driven by another thread.\n");
+        return false;
+    }
+    if(limit > 0 && lowWater >= limit) {
+        coap_log_warn("setInFlightLimit: the low water must be less than the limit.\n");
+        return false;
+    }
+    m_inFlightLimit = limit;
+    m_inFlightLowWater = lowWater;
+    m_inFlightObserver = std::move(observer);
+    m_inFlightRetrySeconds = std::max<uint32_t>(1, retryAfterSeconds);
+    m_overloaded = false;
+    m_inFlightRejected = 0;
+    updateOverloaded();
+    return true;
+}
+
+void ContextServer::updateOverloaded() noexcept
+{
+    bool overloaded;
+    size_t pending = m_asyncPending;
+    if(m_inFlightLimit > 0 && m_overloaded == false && pending >= m_inFlightLimit)
+        overloaded = true;
+    else if(m_overloaded && (m_inFlightLimit == 0 || pending <= m_inFlightLowWater))
+        overloaded = false;
+    else
+        return;
+    m_overloaded = overloaded;
+    if(m_inFlightObserver == nullptr)
+        return;
+    try {
+        m_inFlightObserver(overloaded, pending);
+    }catch(std::exception& e) {
+        coap_log_warn("The in-flight observer throws an exception: %s\n", e.what());
+    }
+}
+
+bool ContextServer::admitRequest(const Resource* resource, coap_session_t* session, coap_pdu_t* response) noexcept
+{
+    // 先检查全局的上限，被拒绝的请求不消耗对等体的令牌
+    if(m_inFlightLimit > 0 && m_asyncPending >= m_inFlightLimit) {
+        m_inFlightRejected.fetch_add(1, std::memory_order_relaxed);
+        rejectRequest(response, Information::ServiceUnavailable, m_inFlightRetrySeconds);
+        return false;
+    }
+    std::shared_ptr<AdmissionController> admission;
+    bool perResource;
+    {
+        std::lock_guard<std::mutex> lock(m_admissionMutex);
+        admission = m_admission;
+        perResource = m_admissionPerResource;
+    }
+    if(admission == nullptr)
+        return true;
+    auto address = coap_session_get_addr_remote(session);
+    if(address == nullptr)
+        return true;
+    AdmissionController::Key key;
+    key.family = address->addr.sa.sa_family;
+    if(key.family == AF_INET) {
+        std::memcpy(key.ip.data(), &address->addr.sin.sin_addr, sizeof(address->addr.sin.sin_addr));
+        key.port = address->addr.sin.sin_port;
+    }
+    else if(key.family == AF_INET6) {
+        std::memcpy(key.ip.data(), &address->addr.sin6.sin6_addr, sizeof(address->addr.sin6.sin6_addr));
+        key.port = address->addr.sin6.sin6_port;
+    }
+    key.resource = perResource ? resource : nullptr;
+    uint32_t retryAfterSeconds = 1;
+    if(admission->admit(key, nowMs(), retryAfterSeconds))
+        return true;
+    rejectRequest(response, Information::TooManyRequests, retryAfterSeconds);
+    return false;
+}
+
+bool ContextServer::startAsyncRequest(Resource* resource, ResourceInterface* imp, coap_session_t* session, 
+                                        const coap_pdu_t* request, const coap_string_t* query) noexcept
+try {
+    if(m_asyncPool == nullptr)
+        m_asyncPool = new ThreadPool(m_asyncWorkerCount);
+    // delay为0表示直到coap_async_trigger()才发送响应，CON请求会立刻得到一个空的ACK
+    auto async = coap_register_async(session, request, 0);
+    if(async == nullptr) {
+        coap_log_warn("coap_register_async() failed, the request is handled synchronously.\n");
+        return false;
+    }
+    auto token = coap_pdu_get_token(request);
+    auto asyncRequest = new AsyncRequest;
+    asyncRequest->resource = resource;
+    asyncRequest->imp = imp;
+    asyncRequest->session = coap_session_reference(session);
+    asyncRequest->snapshot = new SessionSnapshot(session);
+    asyncRequest->async = async;
+    asyncRequest->request = coap_pdu_duplicate(request, session, token.length, token.s, nullptr);
+    asyncRequest->response = coap_pdu_init(COAP_MESSAGE_CON, static_cast<coap_pdu_code_t>(0), 0, coap_session_max_pdu_size(session));
+    asyncRequest->query = query == nullptr ? "" : std::string((const char*)query->s, query->length);
+    coap_async_set_app_data(async, asyncRequest);
+    m_asyncRequests.insert(asyncRequest);
+    m_asyncPending++;
+    updateOverloaded();
+    if(asyncRequest->request == nullptr || asyncRequest->response == nullptr) {
+        coap_log_warn("Failed to copy the request, the request is handled synchronously.\n");
+        coap_free_async(session, async);
+        asyncRequest->async = nullptr;
+        freeAsyncRequest(asyncRequest);
+        return false;
+    }
+    resource->asyncRequestStarted();
+    if(m_asyncPool->submit([this, asyncRequest] { runAsyncRequest(asyncRequest); }) == false) {
+        resource->asyncRequestFinished();
+        coap_free_async(session, async);
+        asyncRequest->async = nullptr;
+        freeAsyncRequest(asyncRequest);
+        return false;
+    }
+    return true;
+}catch(std::exception& e) {
+    coap_log_warn("ContextServer::startAsyncRequest error: %s\n", e.what());
+    return false;
+}
+
+void ContextServer::runAsyncRequest(AsyncRequest* asyncRequest) noexcept
+{
+    try {
+        auto token = coap_pdu_get_token(asyncRequest->request);
+        // 请求的副本在异步请求释放前一直有效，token直接引用其中的数据
+        // 会话只能在网络I/O的线程中访问，工作线程拿到的是只读视图
+        asyncRequest->imp->onRequest(SessionView(asyncRequest->session, asyncRequest->snapshot), std::move(asyncRequest->query), asyncRequest->response, 
+                                     RequestPdu(asyncRequest->request, BinaryConst::Reference(&token)));
+    } catch(std::exception& e) {
+        coap_log_warn("ContextServer::runAsyncRequest error: %s\n", e.what());
+        coap_pdu_set_code(asyncRequest->response, static_cast<coap_pdu_code_t>(Information::NotImplemented));
+    }
+    // 之后不能再访问资源，资源可能在等待该计数归零后被释放
+    asyncRequest->resource->asyncRequestFinished();
+    asyncRequest->finished = true;
+    m_asyncFinished->push(asyncRequest);
+    wakeup();
+}
+
+void ContextServer::completeAsyncRequest(coap_session_t* session, coap_async_t* async, coap_pdu_t* response) noexcept
+{
+    auto asyncRequest = static_cast<AsyncRequest*>(coap_async_get_app_data(async));
+    // 工作线程还没有处理完时收到的重复请求，什么都不回应，CON请求会得到一个空的ACK
+    if(asyncRequest == nullptr || asyncRequest->finished == false)
+        return;
+    auto scratch = asyncRequest->response;
+    coap_pdu_set_code(response, coap_pdu_get_code(scratch));
+    coap_opt_iterator_t oi;
+    coap_option_iterator_init(scratch, &oi, COAP_OPT_ALL);
+    while(auto option = coap_option_next(&oi)) {
+        coap_add_option(response, oi.number, coap_opt_length(option), coap_opt_value(option));
+    }
+    size_t length;
+    const uint8_t* data;
+    if(coap_get_data(scratch, &length, &data))
+        coap_add_data(response, length, data);
+    coap_free_async(session, async);
+    asyncRequest->async = nullptr;
+    freeAsyncRequest(asyncRequest);
+}
+
+void ContextServer::freeAsyncRequest(AsyncRequest* asyncRequest) noexcept
+{
+    if(asyncRequest->async)
+        coap_async_set_app_data(asyncRequest->async, nullptr);
+    if(asyncRequest->request)
+        coap_delete_pdu(asyncRequest->request);
+    if(asyncRequest->response)
+        coap_delete_pdu(asyncRequest->response);
+    coap_session_release(asyncRequest->session);
+    delete asyncRequest->snapshot;
+    m_asyncRequests.erase(asyncRequest);
+    m_asyncPending--;
+    updateOverloaded();
+    delete asyncRequest;
+}
+
 } // namespace CoapPlusPlus
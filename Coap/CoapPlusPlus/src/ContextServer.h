@@ -13,20 +13,33 @@
 
 #include "Context.h"
 #include "coap/Information/GeneralInformation.h"
+#include "coap/Information/PduInformation.h"
+#include <array>
 #include <map>
+#include <string>
+#include <unordered_set>
 
 struct coap_endpoint_t;
+struct coap_session_t;
+struct coap_pdu_t;
+struct coap_string_t;
+struct coap_async_t;
 namespace CoapPlusPlus
 {
 
 class ResourceManager;
+class Resource;
+class ResourceInterface;
 class EndPoint;
-class Session;
+class SessionView;
 class ResponsePdu;
+class ThreadPool;
+class AdmissionController;
+template<typename T> class MpscQueue;
 class ContextServer : public Context
 {
     friend class ResourceManager;
-    static std::function<void(const Session*, const ResponsePdu*, int)> HandsharkeResponedFunction;
+    friend class Resource;
 public:
     /**
      * @brief 构造一个管理服务器相关信息的Context对象
@@ -66,11 +79,11 @@ public:
     void setSessionCloseTimeout(int seconds) noexcept;
 
     /**
-     * @brief 注册一个与客户端握手响应处理函数，用于处理握手响应
+     * @brief 注册一个与客户端握手响应处理函数，用于处理客户端发来的ping，每个ContextServer有各自的处理函数
      * 
-     * @param handler 
+     * @param handler 处理函数，在进行网络I/O的线程中被调用，参数为会话、ping报文和消息id
      */
-    void registerHandshakeResponedFunction(std::function<void(const Session*, const ResponsePdu*, int)> handler) noexcept;
+    void registerHandshakeResponedFunction(std::function<void(const SessionView*, const ResponsePdu*, int)> handler) noexcept;
 
     /**
      * @brief 为服务器Context添加一个端点，用于与对等体进行通信。
@@ -119,14 +132,211 @@ public:
      */
     ResourceManager& getResourceManager() const noexcept { return *m_resourceManager; }
 
+    /**
+     * @brief 设置处理异步资源请求的工作线程数量 @see Resource::enableAsynchronous(bool enable)
+     * 
+     * @param count 线程数量，为0时使用CPU的核心数，默认为0
+     * @return 是否设置成功
+     *      @retval false 工作线程池已经在第一个异步请求到达时创建，无法再修改
+     */
+    bool setAsyncWorkerCount(size_t count) noexcept;
+
+    /**
+     * @brief 获取尚未回应完成的异步请求数量，包括正在工作线程中处理的请求和等待发送响应的请求
+     * 
+     * @return 异步请求数量
+     */
+    size_t getAsyncPendingCount() const noexcept { return m_asyncPending; }
+
+    /**
+     * @brief 优雅地排空服务器，用于重启或者关闭前，避免客户端因为丢失的响应而集中重传
+     * @details 排空开始后，新的请求会被回应5.03——ServiceUnavailable，并通过Max-Age选项告诉客户端多久之后重试；
+     *          已经开始的交互会继续进行，包括异步资源的响应、CON响应和通知的重传、Block2分块传输以及已经触发的观察通知。
+     *          I/O线程正在运行时会先停止它，然后在调用线程中进行网络I/O，直到没有待处理的I/O或者超时。
+     *          服务器加入了IOHub或者其他线程正在进行网络I/O(外部事件循环)时，网络I/O仍由它们进行，
+     *          drain()通过定时器在它们的线程中检查是否已经排空，调用线程只是等待。
+     * 
+     * @param timeoutMs 最多等待的毫秒数
+     * @return 是否在超时前排空
+     *      @retval true 所有交互都已经完成
+     *      @retval false 超时，仍有未完成的交互
+     * 
+     * @note 排空状态不会被解除，之后的请求都会被拒绝，服务器应该随后被销毁。
+     *       libcoap会在分块传输结束后保留一段时间的缓存，这段时间也被视为待处理的I/O。
+     *       使用外部事件循环时，drain()可能与processIO()交替进行网络I/O，期间processIO()会抛出InternalException，
+     *       建议在事件循环所在的线程中调用，或者继续运行事件循环直到drain()返回。
+     *       不能在网络I/O的回调(定时器、资源或者事件的回调)中调用，排空要等回调返回后才能继续，此时直接返回false。
+     */
+    bool drain(int timeoutMs) noexcept;
+
+    /**
+     * @brief 服务器是否处于排空状态 @see drain(int timeoutMs)
+     * 
+     */
+    bool isDraining() const noexcept { return m_draining; }
+
+    /**
+     * @brief 预读的统计信息 @see setMaxReadsPerIOProcess(size_t count)
+     * 
+     */
+    struct ReadAheadStats {
+        uint64_t passes = 0;        // 至少预读了一个数据报的网络I/O处理次数
+        uint64_t datagrams = 0;     // 预读的数据报总数
+        uint64_t maxPerPass = 0;    // 一次网络I/O处理预读的最大数据报数量
+        std::array<uint64_t, 8> histogram {};  // histogram[i]为预读数量在[2^i, 2^(i+1))之间的处理次数，最后一项包含更大的数量
+    };
+
+    /**
+     * @brief 设置每次网络I/O处理最多读取的数据报数量，默认为1(不预读)
+     * @details libcoap每次网络I/O处理中每个就绪的端点只读取一个数据报，突发流量下剩余的数据报
+     *          要经过多次网络I/O处理才能被读取，每次都要执行beforeIOProcess()、定时器、重新计算等待时间和清空唤醒描述符。
+     *          设置大于1的数量后，每次网络I/O处理之后会不等待地预读就绪的数据报，直到没有数据报或者达到数量上限，
+     *          省去的是数据报之间的这些处理。
+     * 
+     * @param count 每次网络I/O处理最多读取的数据报数量，小于等于1表示不预读
+     * @return 是否设置成功
+     *      @retval false libcoap不支持epoll，无法预读
+     * 
+     * @note 可以在任意线程中调用。这不是批量接收：libcoap没有提供recvmmsg的接口，数据报仍由libcoap逐个recvfrom，
+     *       而且每预读一次还要额外调用一次不等待的epoll_wait，每个数据报的系统调用比不预读时多。
+     *       只有数据报之间的处理开销高于一次系统调用时才值得开启。
+     */
+    bool setMaxReadsPerIOProcess(size_t count) noexcept;
+
+    /**
+     * @brief 获取每次网络I/O处理最多读取的数据报数量
+     * 
+     */
+    size_t getMaxReadsPerIOProcess() const noexcept { return m_maxReadsPerIO; }
+
+    /**
+     * @brief 获取预读的统计信息，可以在任意线程中调用
+     * 
+     */
+    ReadAheadStats getReadAheadStats() const noexcept;
+
+    /**
+     * @brief 准入控制的统计信息 @see setRateLimit(double requestsPerSecond, uint32_t burst, bool perResource)
+     * 
+     */
+    struct AdmissionStats {
+        uint64_t admitted = 0;  // 累计通过的请求数量
+        uint64_t rejected = 0;  // 累计回应4.29的请求数量
+        uint64_t tracked = 0;   // 当前跟踪的令牌桶数量
+    };
+
+    /**
+     * @brief 设置按对等体限流的准入控制，默认不限流
+     * @details 每个对等体(远程地址和端口)有一个令牌桶，以requestsPerSecond的速率补充令牌，最多积累burst个。
+     *          每个请求在调用资源回应接口之前消耗一个令牌，没有令牌时回应4.29——TooManyRequests，
+     *          并通过Max-Age选项告诉客户端多少秒后会有新的令牌。一个对等体发送过多的请求只会拒绝它自己。
+     * 
+     * @param requestsPerSecond 每个令牌桶每秒补充的令牌数量，小于等于0表示不限流
+     * @param burst 令牌桶的容量，即允许的突发请求数量，为0时使用requestsPerSecond向上取整(至少为1)
+     * @param perResource 是否为每个对等体的每个资源分别限流
+     * @return 是否设置成功
+     *      @retval false I/O线程正在运行、已经加入IOHub或者其他线程正在进行网络I/O，需要在开始网络I/O之前设置
+     * 
+     * @note 重新设置会清空所有令牌桶和统计信息。异步资源的响应和排空期间的拒绝不消耗令牌。
+     */
+    bool setRateLimit(double requestsPerSecond, uint32_t burst = 0, bool perResource = false) noexcept;
+
+    /**
+     * @brief 获取准入控制的统计信息，可以在任意线程中调用
+     * 
+     */
+    AdmissionStats getAdmissionStats() const noexcept;
+
+    /**
+     * @brief 设置同时处理中的交互数量上限，默认不限制
+     * @details 处理中的交互是尚未回应完成的异步请求 @see getAsyncPendingCount()，它们的请求和响应副本会一直占用内存。
+     *          达到上限后新的请求会被回应5.03——ServiceUnavailable，并通过Max-Age选项告诉客户端多久之后重试。
+     *          处理中的数量达到上限(高水位)时以true调用观察函数，随后降到lowWater(低水位)时以false调用，
+     *          应用可以据此暂停或者推迟其他工作，例如停止触发观察通知。
+     * 
+     * @param limit 处理中的交互数量上限，0表示不限制
+     * @param lowWater 低水位，必须小于limit
+     * @param observer 观察函数，参数为是否过载以及当前处理中的交互数量，在网络I/O的线程中被调用
+     * @param retryAfterSeconds 拒绝请求时建议客户端重试的秒数
+     * @return 是否设置成功
+     *      @retval false I/O线程正在运行、已经加入IOHub或者其他线程正在进行网络I/O，或者lowWater不小于limit
+     * 
+     * @note 同步资源的请求在回调函数中就处理完成，不会积压；但过载时它们同样会被拒绝，把处理能力留给已经接受的交互。
+     */
+    bool setInFlightLimit(size_t limit, size_t lowWater = 0, std::function<void(bool, size_t)> observer = nullptr,
+                          uint32_t retryAfterSeconds = 1) noexcept;
+
+    /**
+     * @brief 获取处理中的交互数量上限，0表示不限制
+     * 
+     */
+    size_t getInFlightLimit() const noexcept { return m_inFlightLimit; }
+
+    /**
+     * @brief 服务器是否处于过载状态，即处理中的交互数量达到上限后还没有降到低水位，可以在任意线程中调用
+     * 
+     */
+    bool isOverloaded() const noexcept { return m_overloaded; }
+
+    /**
+     * @brief 获取因为处理中的交互数量达到上限而被拒绝的请求数量，可以在任意线程中调用
+     * 
+     */
+    uint64_t getInFlightRejectedCount() const noexcept { return m_inFlightRejected.load(std::memory_order_relaxed); }
+
 private:
     coap_endpoint_t* createEndPoint(uint16_t port, Information::Protocol pro);
     bool isReady() const noexcept override;
+    void beforeIOProcess() noexcept override;
+    void queueNotification(const std::string& uriPath, bool wake = true) noexcept;  // 可以在任意线程中调用
+    void afterIOProcess() noexcept override;
+    void readAhead() noexcept;
+
+    struct AsyncRequest;
+    bool startAsyncRequest(Resource* resource, ResourceInterface* imp, coap_session_t* session, 
+                            const coap_pdu_t* request, const coap_string_t* query) noexcept;
+    void runAsyncRequest(AsyncRequest* asyncRequest) noexcept;
+    void completeAsyncRequest(coap_session_t* session, coap_async_t* async, coap_pdu_t* response) noexcept;
+    void freeAsyncRequest(AsyncRequest* asyncRequest) noexcept;
+    void rejectRequest(coap_pdu_t* response, Information::ResponseCode code, uint32_t maxAgeSeconds) noexcept;
+    bool checkDrainedInIOThread(int delayMs, int64_t waitMs) noexcept;
+    bool admitRequest(const Resource* resource, coap_session_t* session, coap_pdu_t* response) noexcept;
+    void updateOverloaded() noexcept;
+    static void PingHandler(coap_session_t* session, const coap_pdu_t* received, const int id) noexcept;
 
 private:
     bool m_persistEnable = false;
     std::map<uint16_t, EndPoint*> m_endpoints;
     ResourceManager* m_resourceManager = nullptr;
+    std::mutex m_handshakeMutex;
+    std::function<void(const SessionView*, const ResponsePdu*, int)> m_handshakeFunction;  // 由m_handshakeMutex保护
+
+    size_t m_asyncWorkerCount = 0;
+    ThreadPool* m_asyncPool = nullptr;
+    MpscQueue<AsyncRequest*>* m_asyncFinished = nullptr;    // 工作线程处理完成的请求
+    MpscQueue<std::string>* m_notifyQueue = nullptr;        // 等待在网络I/O的线程中通知观察者的资源URI路径
+    std::unordered_set<AsyncRequest*> m_asyncRequests;      // 所有未完成的请求，只在网络I/O的线程中访问
+    std::atomic<size_t> m_asyncPending = 0;
+
+    std::atomic<bool> m_draining = false;
+    uint32_t m_drainRetrySeconds = 0;   // 排空期间拒绝请求时建议客户端重试的秒数
+
+    std::atomic<size_t> m_maxReadsPerIO = 1;
+    std::atomic<uint64_t> m_readAheadPasses = 0;
+    std::atomic<uint64_t> m_readAheadDatagrams = 0;
+    std::atomic<uint64_t> m_readAheadMaxPerPass = 0;
+    std::array<std::atomic<uint64_t>, 8> m_readAheadHistogram {};
+
+    mutable std::mutex m_admissionMutex;
+    std::shared_ptr<AdmissionController> m_admission;   // 由m_admissionMutex保护，令牌桶只在网络I/O的线程中访问
+    bool m_admissionPerResource = false;                // 由m_admissionMutex保护
+
+    size_t m_inFlightLimit = 0;
+    size_t m_inFlightLowWater = 0;
+    uint32_t m_inFlightRetrySeconds = 1;
+    std::function<void(bool, size_t)> m_inFlightObserver;
+    std::atomic<bool> m_overloaded = false;
+    std::atomic<uint64_t> m_inFlightRejected = 0;
 };
 
 
@@ -0,0 +1,110 @@
+#include <coap3/coap.h>
+#include "ContextServerGroup.h"
+#include "ContextServer.h"
+#include "ResourceManager.h"
+#include "Resource.h"
+#include "coap/exception.h"
+
+#include <algorithm>
+#include <thread>
+
+namespace CoapPlusPlus
+{
+
+ContextServerGroup::ContextServerGroup(size_t workerCount)
+{
+    if(workerCount == 0)
+        workerCount = std::max(1u, std::thread::hardware_concurrency());
+    try {
+        for(size_t i = 0; i < workerCount; i++)
+            m_workers.push_back(new ContextServer());
+    }catch(...) {
+        for(auto worker : m_workers)
+            delete worker;
+        throw;
+    }
+}
+
+ContextServerGroup::~ContextServerGroup() noexcept
+{
+    stop();
+    for(auto worker : m_workers)
+        delete worker;
+    m_workers.clear();
+}
+
+bool ContextServerGroup::addEndPoint(uint16_t basePort, Information::Protocol pro) noexcept
+{
+    if(m_running || basePort + m_workers.size() - 1 > UINT16_MAX)
+        return false;
+    for(size_t i = 0; i < m_workers.size(); i++) {
+        if(m_workers[i]->addEndPoint(basePort + i, pro) == false) {
+            for(size_t j = 0; j < i; j++)
+                m_workers[j]->removeEndPoint(basePort + j);
+            return false;
+        }
+    }
+    return true;
+}
+
+bool ContextServerGroup::registerResource(std::function<std::unique_ptr<Resource>()> factory) noexcept
+try{
+    if(m_running || !factory)
+        return false;
+    std::string uriPath;
+    for(size_t i = 0; i < m_workers.size(); i++) {
+        auto resource = factory();
+        if(resource)
+            uriPath = resource->getUriPath();
+        if(!resource || m_workers[i]->getResourceManager().registerResource(std::move(resource)) == false) {
+            for(size_t j = 0; j < i; j++)
+                m_workers[j]->getResourceManager().unregisterResource(uriPath);
+            return false;
+        }
+    }
+    return true;
+}catch(std::exception& e) {
+    coap_log_warn("ContextServerGroup::registerResource: %s\n", e.what());
+    return false;
+}
+
+bool ContextServerGroup::unregisterResource(const std::string& uriPath) noexcept
+{
+    if(m_running)
+        return false;
+    bool result = true;
+    for(auto worker : m_workers)
+        result = worker->getResourceManager().unregisterResource(uriPath) && result;
+    return result;
+}
+
+bool ContextServerGroup::start(int waitMs) noexcept
+{
+    if(m_running)
+        return false;
+    for(size_t i = 0; i < m_workers.size(); i++) {
+        if(m_workers[i]->startIOProcess(waitMs) == false) {
+            for(size_t j = 0; j < i; j++)
+                m_workers[j]->stopIOProcess();
+            return false;
+        }
+    }
+    m_running = true;
+    return true;
+}
+
+void ContextServerGroup::stop() noexcept
+{
+    for(auto worker : m_workers)
+        worker->stopIOProcess();
+    m_running = false;
+}
+
+ContextServer& ContextServerGroup::getWorker(size_t index) const
+{
+    if(index >= m_workers.size())
+        throw TargetNotFoundException("Worker with index " + std::to_string(index) + " does not exist");
+    return *m_workers[index];
+}
+
+};  // namespace CoapPlusPlus
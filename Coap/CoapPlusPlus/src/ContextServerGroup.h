@@ -0,0 +1,126 @@
+/**
+ * @file ContextServerGroup.h
+ * @author Hulu
+ * @brief 多核分片的服务器组类定义
+ * @version 0.1
+ * @date 2023-08-24
+ * 
+ * @copyright Copyright (c) 2023
+ * 
+ */
+#pragma once
+
+#include "coap/Information/GeneralInformation.h"
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace CoapPlusPlus
+{
+
+class ContextServer;
+class Resource;
+
+/**
+ * @brief 多核分片的服务器组
+ * @details 一个ContextServer只有一个coap_context_t，只能在一个线程中处理网络I/O，所以最多只能利用一个核。
+ *          服务器组启动多个ContextServer作为工作者，每个工作者有自己的coap_context_t、端点和I/O线程，
+ *          资源通过工厂函数在每个工作者中各注册一份，请求的处理能力随工作者数量增长。
+ * 
+ * @attention libcoap在内部创建并绑定端点的套接字，没有提供在bind之前设置SO_REUSEPORT的接口，
+ *            所以多个工作者无法共享同一个端口，第i个工作者的端点使用 basePort + i 端口，
+ *            客户端需要自行把请求分散到这些端口上（例如按设备ID取模）。
+ */
+class ContextServerGroup
+{
+    ContextServerGroup& operator=(const ContextServerGroup&) = delete;
+    ContextServerGroup& operator=(ContextServerGroup&&) = delete;
+    ContextServerGroup(const ContextServerGroup&) = delete;
+    ContextServerGroup(ContextServerGroup&&) = delete;
+public:
+    /**
+     * @brief 构造一个服务器组
+     * 
+     * @param workerCount 工作者数量，为0时使用CPU的核数
+     * 
+     * @exception InternalException 创建Context失败会抛出该异常
+     */
+    explicit ContextServerGroup(size_t workerCount = 0);
+    ~ContextServerGroup() noexcept;
+
+    /**
+     * @brief 为每个工作者添加一个端点，第i个工作者的端点使用 basePort + i 端口
+     * 
+     * @param basePort 第一个工作者使用的端口号
+     * @param pro 端点使用的协议，默认为UDP
+     * @return 是否添加成功，任意一个工作者添加失败都会移除已经添加的端点并返回false
+     */
+    bool addEndPoint(uint16_t basePort, Information::Protocol pro = Information::Udp) noexcept;
+
+    /**
+     * @brief 为每个工作者注册一个资源
+     * 
+     * @param factory 资源的工厂函数，每个工作者调用一次，每次都要返回一个新的资源对象
+     * @return 是否注册成功
+     *      @retval true 注册成功
+     *      @retval false 服务器组正在运行、工厂函数返回空或者资源已经被注册
+     * 
+     * @note 资源需要在start()之前注册
+     */
+    bool registerResource(std::function<std::unique_ptr<Resource>()> factory) noexcept;
+
+    /**
+     * @brief 为每个工作者注销一个资源
+     * 
+     * @param uriPath 该资源的URI路径
+     * @return 是否注销成功，服务器组正在运行或者没有找到该资源时返回false
+     */
+    bool unregisterResource(const std::string& uriPath) noexcept;
+
+    /**
+     * @brief 启动所有工作者的I/O线程
+     * 
+     * @param waitMs 含义同Context::startIOProcess(int waitMs)
+     * @return 是否启动成功，任意一个工作者启动失败都会停止已经启动的工作者并返回false
+     */
+    bool start(int waitMs = 0) noexcept;
+
+    /**
+     * @brief 停止所有工作者的I/O线程
+     * 
+     */
+    void stop() noexcept;
+
+    /**
+     * @brief 服务器组是否正在运行
+     * 
+     * @return true 正在运行
+     * @return false 没有运行
+     */
+    bool isRunning() const noexcept { return m_running; }
+
+    /**
+     * @brief 得到工作者数量
+     * 
+     * @return 工作者数量
+     */
+    size_t getWorkerCount() const noexcept { return m_workers.size(); }
+
+    /**
+     * @brief 得到一个工作者，可以用于单独配置某个工作者
+     * 
+     * @param index 工作者的序号
+     * @return 工作者的引用，生命周期由ContextServerGroup管理
+     * 
+     * @exception TargetNotFoundException 序号超出范围会抛出该异常
+     */
+    ContextServer& getWorker(size_t index) const;
+
+private:
+    std::vector<ContextServer*> m_workers;
+    bool m_running = false;
+};
+
+};  // namespace CoapPlusPlus
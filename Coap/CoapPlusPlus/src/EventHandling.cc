@@ -1,6 +1,6 @@
 #include "EventHandling.h"
 #include "Context.h"
-#include "coap/Session.h"
+#include "coap/SessionView.h"
 #include <coap3/coap.h>
 #include <stdexcept>
 
@@ -60,55 +60,55 @@ try{
     if(handling) {
         switch(type) {
         case DTLS_CLOSED:
-            handling->onDtlsClosed(Session(session, false));
+            handling->onDtlsClosed(SessionView(session));
             break;
         case DTLS_CONNECTED:
-            handling->onDtlsConnected(Session(session, false));
+            handling->onDtlsConnected(SessionView(session));
             break;
         case DTLS_ERROR:
-            handling->onDtlsError(Session(session, false));
+            handling->onDtlsError(SessionView(session));
             break;
         case DTLS_RENEGOTIATION:
-            handling->onDtlsRenegotiation(Session(session, false));
+            handling->onDtlsRenegotiation(SessionView(session));
             break;
         case TCP_CLOSED:
-            handling->onTcpClosed(Session(session, false));
+            handling->onTcpClosed(SessionView(session));
             break;
         case TCP_CONNECTED:
-            handling->onTcpConnected(Session(session, false));
+            handling->onTcpConnected(SessionView(session));
             break;
         case TCP_FAILED:
-            handling->onTcpFailed(Session(session, false));
+            handling->onTcpFailed(SessionView(session));
             break;
         case TCP_SESSION_CLOSED:
-            handling->onSessionClosed(Session(session, false));
+            handling->onSessionClosed(SessionView(session));
             break;
         case TCP_SESSION_CONNECTED:
-            handling->onSessionConnected(Session(session, false));
+            handling->onSessionConnected(SessionView(session));
             break;
         case TCP_SESSION_FAILED:
-            handling->onSessionFailed(Session(session, false));
+            handling->onSessionFailed(SessionView(session));
             break;
         case PARTIAL_BLOCK:
-            handling->onPartialBlock(Session(session, false));
+            handling->onPartialBlock(SessionView(session));
             break;
         case XMIT_BLOCK_FAILED:
-            handling->onXmitBlockFail(Session(session, false));
+            handling->onXmitBlockFail(SessionView(session));
             break;
         case NEW_CLIENT:
-            handling->onServerSessionConnected(Session(session, false));
+            handling->onServerSessionConnected(SessionView(session));
             break;
         case DEL_CLIENT:
-            handling->onServerSessionClosed(Session(session, false));
+            handling->onServerSessionClosed(SessionView(session));
             break;
         case BAD_PACKET:
-            handling->onBadPacket(Session(session, false));
+            handling->onBadPacket(SessionView(session));
             break;
         case MSG_RESEND_FAILED:
-            handling->onMSGRetransmit(Session(session, false));
+            handling->onMSGRetransmit(SessionView(session));
             break;
         case KEEPALIVE_FAILED:
-            handling->onKeepAliveFailured(Session(session, false));
+            handling->onKeepAliveFailured(SessionView(session));
             break;
         default:
             throw std::runtime_error("unknown event type");
@@ -0,0 +1,53 @@
+#include <coap3/coap.h>
+#include "FutureHandling.h"
+#include "coap/DataStruct/BinaryConst.h"
+#include "coap/Pdu/RequestPdu.h"
+#include "coap/Pdu/ResponsePdu.h"
+
+namespace CoapPlusPlus {
+
+SendersManager::FutureHandling::FutureHandling(BinaryConst token, coap_session_t* session, std::promise<Response> promise) noexcept
+    : Handling(COAP_INVALID_MID, token), m_session(session), m_promise(std::move(promise)) { }
+
+bool SendersManager::FutureHandling::onAck(Session &session, const RequestPdu *request, const ResponsePdu *response) noexcept
+{
+    if(m_done || response == nullptr)
+        return true;
+    // 收到的报文在回调返回后就会被libcoap释放，结果需要持有一份副本
+    auto coap_token = coap_pdu_get_token(response->m_rawPdu);
+    auto copy = coap_pdu_duplicate(response->m_rawPdu, m_session, coap_token.length, coap_token.s, nullptr);
+    if(copy == nullptr) {
+        coap_log_warn("FutureHandling: failed to copy the response.\n");
+        setResult(Response(Response::NAck, BadResponse));
+    }
+    else
+        setResult(Response(copy));
+    return true;
+}
+
+void SendersManager::FutureHandling::onNAck(Session &session, RequestPdu request, NAckReason reason) noexcept
+{
+    if(m_done)
+        return;
+    setResult(Response(Response::NAck, reason));
+}
+
+void SendersManager::FutureHandling::readyDestroyed() noexcept
+{
+    if(m_context)
+        m_context->cancelTimer(m_timer);
+    m_context = nullptr;
+    if(m_done)
+        return;
+    setResult(m_timedOut ? Response(Response::Timeout, NotDelivered) : Response(Response::NAck, NotDelivered));
+}
+
+void SendersManager::FutureHandling::setResult(Response response) noexcept
+try{
+    m_done = true;
+    m_promise.set_value(std::move(response));
+}catch(std::exception &e) {
+    coap_log_warn("FutureHandling: %s\n", e.what());
+}
+
+}; // namespace CoapPlusPlus
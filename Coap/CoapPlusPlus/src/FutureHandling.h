@@ -0,0 +1,64 @@
+/**
+ * @file FutureHandling.h
+ * @author Hulu
+ * @brief 把响应转换为std::future结果的处理器
+ * @version 0.1
+ * @date 2023-09-01
+ * 
+ * @copyright Copyright (c) 2023
+ * 
+ */
+#pragma once
+
+#include "coap/Handling.h"
+#include "coap/SendersManager.h"
+#include "coap/Context.h"
+#include "Response.h"
+#include <future>
+
+struct coap_session_t;
+
+namespace CoapPlusPlus
+{
+
+class SendersManager::FutureHandling : public Handling {
+
+public:
+    FutureHandling(BinaryConst token, coap_session_t* session, std::promise<Response> promise) noexcept;
+    ~FutureHandling() noexcept override {}
+
+    bool onAck(Session& session, const RequestPdu* request, const ResponsePdu* response) noexcept override;
+
+    void onNAck(Session& session, RequestPdu request, NAckReason reason) noexcept override;
+
+    // 被移除或者销毁时还没有结果，说明请求超时或者被放弃了
+    void readyDestroyed() noexcept override;
+
+    bool isFinished() noexcept override { return m_done; }
+
+    /**
+     * @brief 记录期限定时器，处理器销毁时取消该定时器
+     * 
+     */
+    void setTimer(Context* context, Context::TimerId id) noexcept { m_context = context; m_timer = id; }
+
+    /**
+     * @brief 标记期限已到，随后被移除时以Timeout结束
+     * 
+     */
+    void expire() noexcept { m_timedOut = true; }
+
+private:
+    void setResult(Response response) noexcept;
+
+private:
+    coap_session_t* m_session;
+    std::promise<Response> m_promise;
+    bool m_done = false;
+    bool m_timedOut = false;
+    Context* m_context = nullptr;
+    Context::TimerId m_timer = 0;
+};
+
+
+};
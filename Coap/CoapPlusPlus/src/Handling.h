@@ -57,7 +57,7 @@ public:
      * @brief 当发出Pdu请求在规定时间内没正常应答会自动调用该函数。
      * 
      * @param session 当前客户端会话
-     * @param request 请求的Pdu
+     * @param request 请求的Pdu，只在回调期间有效，token直接引用请求报文中的数据
      * @param reason 未正常应答的原因
      */
     virtual void onNAck(Session& session, RequestPdu request, NAckReason reason) noexcept = 0;
@@ -0,0 +1,307 @@
+/**
+ * @file IOHub.cc
+ * @author Hulu
+ * @brief I/O集线器类实现
+ * @version 0.1
+ * @date 2023-08-30
+ *
+ * @copyright Copyright (c) 2023
+ *
+ */
+#include <coap3/coap.h>
+#include "IOHub.h"
+#include "Context.h"
+#include "coap/exception.h"
+
+#include <chrono>
+
+#ifdef __linux__
+#include <sys/eventfd.h>
+#include <sys/epoll.h>
+#include <unistd.h>
+#include <cerrno>
+#endif
+
+namespace CoapPlusPlus
+{
+
+// 每次epoll_wait最多取出的事件数量
+static constexpr int IO_HUB_MAX_EVENTS = 64;
+
+static int64_t SteadyNowMs() noexcept
+{
+    using namespace std::chrono;
+    return duration_cast<milliseconds>(steady_clock::now().time_since_epoch()).count();
+}
+
+IOHub::IOHub()
+{
+#ifdef __linux__
+    m_epollFd = epoll_create1(EPOLL_CLOEXEC);
+    if(m_epollFd < 0)
+        throw InternalException("Failed to call the epoll_create1 function!");
+    m_wakeupFd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    struct epoll_event event = {};
+    event.events = EPOLLIN;
+    event.data.ptr = nullptr;
+    if(m_wakeupFd < 0 || epoll_ctl(m_epollFd, EPOLL_CTL_ADD, m_wakeupFd, &event) < 0) {
+        if(m_wakeupFd >= 0)
+            ::close(m_wakeupFd);
+        ::close(m_epollFd);
+        throw InternalException("Failed to create the wakeup descriptor of IOHub!");
+    }
+#else
+    throw InternalException("IOHub requires epoll, which is only supported on Linux.");
+#endif
+}
+
+IOHub::~IOHub() noexcept
+{
+    stop();
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        for(auto& [context, entry] : m_contexts) {
+            std::lock_guard<std::mutex> contextLock(context->m_mutex);
+            context->m_ioHub = nullptr;
+        }
+        m_contexts.clear();
+    }
+#ifdef __linux__
+    ::close(m_wakeupFd);
+    ::close(m_epollFd);
+#endif
+}
+
+bool IOHub::addContext(Context& context) noexcept
+{
+#ifdef __linux__
+    auto fd = context.getFileDescriptor();
+    if(fd < 0) {
+        coap_log_warn("libcoap does not support epoll, unable to add the context to IOHub.\n");
+        return false;
+    }
+    {
+        // 先集线器的锁后Context的锁，与startIOProcess()在同一个锁下检查，两者不会同时成功
+        std::lock_guard<std::mutex> lock(m_mutex);
+        std::lock_guard<std::mutex> contextLock(context.m_mutex);
+        if(context.m_ioHub != nullptr)
+            return false;
+        if(context.isIOProcessRunning()) {
+            coap_log_warn("The I/O thread of the context is running, unable to add it to IOHub.\n");
+            return false;
+        }
+        struct epoll_event event = {};
+        event.events = EPOLLIN;
+        event.data.ptr = &context;
+        if(epoll_ctl(m_epollFd, EPOLL_CTL_ADD, fd, &event) < 0) {
+            coap_log_warn("epoll_ctl() failed, unable to add the context to IOHub.\n");
+            return false;
+        }
+        m_contexts.emplace(&context, Entry());
+        context.m_ioHub = this;
+    }
+    // 让正在等待的集线器重新计算等待时间
+    wakeup();
+    return true;
+#else
+    return false;
+#endif
+}
+
+bool IOHub::removeContext(Context& context) noexcept
+{
+#ifdef __linux__
+    std::unique_lock<std::mutex> lock(m_mutex);
+    auto iter = m_contexts.find(&context);
+    bool removed = iter != m_contexts.end();
+    if(removed) {
+        epoll_ctl(m_epollFd, EPOLL_CTL_DEL, context.getFileDescriptor(), nullptr);
+        m_contexts.erase(iter);
+        std::lock_guard<std::mutex> contextLock(context.m_mutex);
+        context.m_ioHub = nullptr;
+    }
+    // 集线器正在其他线程中处理该Context时，等待处理结束，返回后不会再访问它；
+    // 在它自己的回调中移除时不能等待，处理结束后也不会再次访问
+    if(m_dispatchThread != std::this_thread::get_id())
+        m_dispatchCond.wait(lock, [this, &context]() { return m_dispatching != &context; });
+    return removed;
+#else
+    return false;
+#endif
+}
+
+size_t IOHub::getContextCount() const noexcept
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_contexts.size();
+}
+
+int IOHub::ioProcess(int waitMs)
+{
+    if(m_running) {
+        coap_log_warn("The I/O thread of IOHub is running, ioProcess() is not allowed.\n");
+        return -1;
+    }
+    if(m_busy.exchange(true)) {
+        coap_log_warn("IOHub is busy in another thread, ioProcess() is not allowed.\n");
+        return -1;
+    }
+    auto result = doIOProcess(waitMs > 0 ? waitMs : waitMs == 0 ? -1 : 0);
+    m_busy = false;
+    return result;
+}
+
+bool IOHub::start() noexcept
+{
+    std::lock_guard<std::mutex> lock(m_threadMutex);
+    if(m_thread != nullptr) {
+        if(m_running) {
+            coap_log_warn("The I/O thread of IOHub is already running.\n");
+            return false;
+        }
+        m_thread->join();
+        delete m_thread;
+        m_thread = nullptr;
+    }
+    if(m_busy.exchange(true)) {
+        coap_log_warn("IOHub is busy in another thread, unable to start the I/O thread.\n");
+        return false;
+    }
+    m_running = true;
+    m_thread = new std::thread(&IOHub::threadFunc, this);
+    return true;
+}
+
+void IOHub::stop() noexcept
+{
+    std::lock_guard<std::mutex> lock(m_threadMutex);
+    m_running = false;
+    wakeup();
+    if(m_thread) {
+        if(m_thread->joinable())
+            m_thread->join();
+        delete m_thread;
+        m_thread = nullptr;
+    }
+}
+
+void IOHub::wakeup() noexcept
+{
+#ifdef __linux__
+    uint64_t one = 1;
+    auto n = ::write(m_wakeupFd, &one, sizeof(one));
+    (void)n; // 计数器溢出时(EAGAIN)说明已经处于唤醒状态
+#endif
+}
+
+int IOHub::doIOProcess(int timeoutMs) noexcept
+{
+#ifdef __linux__
+    auto begin = SteadyNowMs();
+    m_dispatchList.clear();
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        for(auto& [context, entry] : m_contexts) {
+            entry.ready = false;
+            entry.deadline = -1;
+            m_dispatchList.push_back(context);
+        }
+    }
+    // 发送待发的数据、执行到期的定时器，并取所有Context中最近的定时事件。
+    // 调用Context时不持有锁，回调中可以移除Context
+    for(auto context : m_dispatchList) {
+        if(beginDispatch(context) == false)
+            continue;
+        int timeout = -1;
+        try {
+            timeout = context->prepareIO();
+        }
+        catch(const std::exception& e) {
+            // 没有端点或者会话的Context，或者正在析构的Context，跳过即可
+            coap_log_debug("IOHub: prepareIO() failed: %s\n", e.what());
+        }
+        endDispatch(context, timeout < 0 ? -1 : begin + timeout);
+        if(timeout >= 0 && (timeoutMs < 0 || timeout < timeoutMs))
+            timeoutMs = timeout;
+    }
+    struct epoll_event events[IO_HUB_MAX_EVENTS];
+    auto count = epoll_wait(m_epollFd, events, IO_HUB_MAX_EVENTS, timeoutMs);
+    if(count < 0 && errno != EINTR) {
+        coap_log_err("IOHub: epoll_wait() failed.\n");
+        return -1;
+    }
+    m_dispatchList.clear();
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        for(int i = 0; i < count; i++) {
+            if(events[i].data.ptr == nullptr) {
+                uint64_t value;
+                auto n = ::read(m_wakeupFd, &value, sizeof(value));
+                (void)n;
+                continue;
+            }
+            // 等待期间可能已经被移除
+            auto iter = m_contexts.find(static_cast<Context*>(events[i].data.ptr));
+            if(iter != m_contexts.end())
+                iter->second.ready = true;
+        }
+        auto now = SteadyNowMs();
+        for(auto& [context, entry] : m_contexts) {
+            if(entry.ready || (entry.deadline >= 0 && entry.deadline <= now))
+                m_dispatchList.push_back(context);
+        }
+    }
+    for(auto context : m_dispatchList) {
+        if(beginDispatch(context) == false)
+            continue;
+        try {
+            context->processIO();
+        }
+        catch(const std::exception& e) {
+            coap_log_debug("IOHub: processIO() failed: %s\n", e.what());
+        }
+        endDispatch(context);
+    }
+    return static_cast<int>(SteadyNowMs() - begin);
+#else
+    return -1;
+#endif
+}
+
+bool IOHub::beginDispatch(Context* context) noexcept
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    // 取出列表之后可能已经被移除，此时Context可能已经析构
+    if(m_contexts.find(context) == m_contexts.end())
+        return false;
+    m_dispatching = context;
+    m_dispatchThread = std::this_thread::get_id();
+    return true;
+}
+
+void IOHub::endDispatch(Context* context, int64_t deadline) noexcept
+{
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        auto iter = m_contexts.find(context);
+        if(iter != m_contexts.end())
+            iter->second.deadline = deadline;
+        m_dispatching = nullptr;
+        m_dispatchThread = std::thread::id();
+    }
+    m_dispatchCond.notify_all();
+}
+
+void IOHub::threadFunc() noexcept
+{
+    while(m_running) {
+        if(doIOProcess(-1) < 0) {
+            coap_log_err("IOHub: the I/O thread exits because of an error.\n");
+            break;
+        }
+    }
+    m_running = false;
+    m_busy = false;
+}
+
+};// namespace CoapPlusPlus
\ No newline at end of file
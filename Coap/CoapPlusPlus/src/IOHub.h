@@ -0,0 +1,148 @@
+/**
+ * @file IOHub.h
+ * @author Hulu
+ * @brief 多个Context共享一个I/O线程的I/O集线器类定义
+ * @version 0.1
+ * @date 2023-08-30
+ *
+ * @copyright Copyright (c) 2023
+ *
+ */
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+namespace CoapPlusPlus
+{
+
+class Context;
+
+/**
+ * @brief I/O集线器，用一个epoll集合等待多个Context的文件描述符，只处理已经就绪的Context
+ * @details 每个Context都有自己的coap_context_t，单独处理时需要各自的轮询循环或者I/O线程。
+ *          集线器把所有Context的getFileDescriptor()加入同一个epoll集合，
+ *          每次循环先对所有Context调用prepareIO()得到最近的定时事件，
+ *          等待结束后只对可读或者定时事件到期的Context调用processIO()，
+ *          几十个客户端和服务器可以共享一个线程。
+ *
+ * @note 需要libcoap支持epoll，目前仅支持Linux。
+ *       加入集线器的Context不能再启动自己的I/O线程，Context析构时会自动从集线器中移除。
+ *       集线器调用prepareIO()和processIO()时不持有内部的锁，回调中可以加入或者移除Context，
+ *       但不能析构正在被处理的Context自己。
+ *
+ * @code {.cpp}
+ * IOHub hub;
+ * for(auto& client : clients)
+ *     hub.addContext(*client);
+ * hub.start();
+ * ...
+ * hub.stop();
+ * @endcode
+ */
+class IOHub
+{
+    IOHub& operator=(const IOHub&) = delete;
+    IOHub& operator=(IOHub&&) = delete;
+    IOHub(const IOHub&) = delete;
+    IOHub(IOHub&&) = delete;
+public:
+    /**
+     * @brief 构造一个I/O集线器
+     *
+     * @exception InternalException 当前平台不支持epoll或者创建epoll失败
+     */
+    IOHub();
+    ~IOHub() noexcept;
+
+    /**
+     * @brief 把一个Context加入集线器，可以在任意线程中调用
+     *
+     * @param context 要加入的Context，生命周期由调用者管理
+     * @return 是否加入成功
+     *      @retval false Context已经加入了某个集线器、I/O线程正在运行或者libcoap不支持epoll
+     */
+    bool addContext(Context& context) noexcept;
+
+    /**
+     * @brief 从集线器中移除一个Context，可以在任意线程中调用，函数返回后集线器不会再访问该Context
+     * @details 集线器正在其他线程中处理该Context时，会等待这一次处理结束后再返回；
+     *          在该Context自己的回调中调用时不等待，本次处理结束后集线器不再访问它。
+     *
+     * @param context 要移除的Context
+     * @return 是否移除成功，Context不在该集线器中时返回false
+     */
+    bool removeContext(Context& context) noexcept;
+
+    /**
+     * @brief 获取集线器中的Context数量
+     *
+     */
+    size_t getContextCount() const noexcept;
+
+    /**
+     * @brief 在调用线程中进行一次所有Context的网络I/O处理
+     *
+     * @param waitMs 等待的毫秒数，含义同Context::ioProcess(int waitMs)，等待会在任意Context的定时事件到期时提前结束
+     * @return 返回在函数中花费的毫秒数；如果出现错误，则返回 -1
+     *
+     * @note 集线器的I/O线程运行期间调用该函数会直接返回-1
+     */
+    int ioProcess(int waitMs = 1000);
+
+    /**
+     * @brief 启动集线器的I/O线程，循环进行所有Context的网络I/O处理
+     *
+     * @return 是否启动成功，I/O线程已经在运行时返回false
+     */
+    bool start() noexcept;
+
+    /**
+     * @brief 停止集线器的I/O线程，函数返回时I/O线程已经退出
+     *
+     */
+    void stop() noexcept;
+
+    /**
+     * @brief 集线器的I/O线程是否正在运行
+     *
+     */
+    bool isRunning() const noexcept { return m_running; }
+
+    /**
+     * @brief 唤醒阻塞中的集线器，可以在任意线程中调用
+     *
+     */
+    void wakeup() noexcept;
+
+private:
+    struct Entry {
+        int64_t deadline = -1;  // 最近的定时事件到期时间，-1表示没有
+        bool ready = false;
+    };
+    int doIOProcess(int timeoutMs) noexcept;
+    void threadFunc() noexcept;
+    bool beginDispatch(Context* context) noexcept;
+    void endDispatch(Context* context, int64_t deadline = -1) noexcept;
+
+private:
+    int m_epollFd = -1;
+    int m_wakeupFd = -1;
+    mutable std::mutex m_mutex;
+    std::unordered_map<Context*, Entry> m_contexts;
+    std::vector<Context*> m_dispatchList;       // 本次要处理的Context，只在进行网络I/O的线程中使用
+    Context* m_dispatching = nullptr;           // 正在处理的Context，由m_mutex保护
+    std::thread::id m_dispatchThread;           // 处理Context的线程，由m_mutex保护
+    std::condition_variable m_dispatchCond;     // 一次处理结束时通知
+    std::mutex m_threadMutex;
+    std::thread* m_thread = nullptr;
+    std::atomic<bool> m_running = false;
+    std::atomic<bool> m_busy = false;
+};
+
+};// namespace CoapPlusPlus
\ No newline at end of file
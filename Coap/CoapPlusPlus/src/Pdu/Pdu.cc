@@ -48,6 +48,18 @@ bool Pdu::isContainOption(OptionNumber number) const
     return coap_check_option(m_rawPdu, number, &oi) != nullptr;
 }
 
+bool Pdu::getContentFormat(ContentFormatType& type) const noexcept
+{
+    if(m_rawPdu == nullptr)
+        return false;
+    coap_opt_iterator_t oi;
+    auto opt = coap_check_option(m_rawPdu, ContentFormat, &oi);
+    if(opt == nullptr)
+        return false;
+    type = static_cast<ContentFormatType>(coap_decode_var_bytes(coap_opt_value(opt), coap_opt_length(opt)));
+    return true;
+}
+
 std::vector<Option> Pdu::getOptions(OptFilter filter) const
 {
     if(m_rawPdu == nullptr)
@@ -133,6 +133,14 @@ protected:
     ~Pdu() noexcept { }
     coap_pdu_t* getPdu() const noexcept { return m_rawPdu; }
 
+    /**
+     * @brief 直接从报文中读取Content-Format选项，不构造Option对象，不分配内存
+     * 
+     * @param type 写入负载的格式
+     * @return 是否包含Content-Format选项
+     */
+    bool getContentFormat(ContentFormatType& type) const noexcept;
+
 protected:
     coap_pdu_t* m_rawPdu = nullptr;
     
@@ -2,9 +2,7 @@
 #include "RequestPdu.h"
 #include "Options.h"
 #include "Option.h"
-#include "OptFilter.h"
 #include "Encoder.h"
-#include "Decoder.h"
 #include "Payload.h"
 
 namespace CoapPlusPlus {
@@ -77,13 +75,9 @@ try{
         size_t pdu_data_length;
         const uint8_t *pdu_data;
         auto data = coap_get_data(m_rawPdu, &pdu_data_length, &pdu_data);
-        if(data != 0){
-            auto opts = getOptions(OptFilter(std::vector<Information::OptionNumber>{Information::ContentFormat}));
-            if(opts.size() > 0) {
-                auto value = static_cast<Information::ContentFormatType>(Decoder::Decode(opts[0].getData()));
-                m_payload = Payload(pdu_data_length, pdu_data, value);
-            }
-        }
+        Information::ContentFormatType value;
+        if(data != 0 && getContentFormat(value))
+            m_payload = Payload(pdu_data_length, pdu_data, value);
     }
 }catch(std::exception &e){
     coap_log_err(e.what());
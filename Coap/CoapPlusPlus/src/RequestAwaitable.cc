@@ -0,0 +1,103 @@
+#include "RequestAwaitable.h"
+#include "SendersManager.h"
+#include "coap/DataStruct/BinaryConst.h"
+#include <coap3/coap.h>
+#include <exception>
+#include <memory>
+#include <utility>
+
+namespace CoapPlusPlus
+{
+
+/**
+ * @brief 把回调转换为协程恢复的处理器，生命周期仍然由SendersManager管理
+ *
+ */
+class RequestAwaitable::AwaitHandling : public Handling
+{
+public:
+    AwaitHandling(RequestAwaitable& awaitable, BinaryConst token) noexcept
+        : Handling(COAP_INVALID_MID, std::move(token)), m_awaitable(&awaitable) { }
+
+    bool onAck(Session& session, const RequestPdu* request, const ResponsePdu* response) noexcept override {
+        if(m_awaitable == nullptr)
+            return true;
+        auto awaitable = std::exchange(m_awaitable, nullptr);
+        if(response)
+            awaitable->m_result.response.emplace(*response);
+        else
+            awaitable->m_result.nackReason = BadResponse;
+        awaitable->complete();
+        return true;
+    }
+
+    void onNAck(Session& session, RequestPdu request, NAckReason reason) noexcept override {
+        if(m_awaitable == nullptr)
+            return;
+        auto awaitable = std::exchange(m_awaitable, nullptr);
+        awaitable->m_result.nackReason = reason;
+        awaitable->complete();
+    }
+
+    // 被提前移除(removeHandling或者SendersManager析构)时，协程不会再等到结果
+    void readyDestroyed() noexcept override {
+        if(m_awaitable == nullptr)
+            return;
+        auto awaitable = std::exchange(m_awaitable, nullptr);
+        awaitable->m_result.nackReason = NotDelivered;
+        awaitable->complete();
+    }
+
+    // 恢复协程后，awaitable已经随协程帧失效，不再保留该处理器
+    bool isFinished() noexcept override { return m_awaitable == nullptr; }
+
+private:
+    RequestAwaitable* m_awaitable;
+};
+
+RequestAwaitable::RequestAwaitable(SendersManager& manager, RequestPdu pdu) noexcept
+    : m_manager(&manager), m_pdu(std::move(pdu))
+{
+}
+
+bool RequestAwaitable::await_suspend(std::coroutine_handle<> handle)
+{
+    m_handle = handle;
+    m_sending = true;
+    auto token = m_pdu.token().toBinaryConst();
+    bool sent;
+    try {
+        sent = m_manager->send(m_pdu, std::make_unique<AwaitHandling>(*this, token));
+    }catch(...) {
+        m_sending = false;
+        throw;
+    }
+    // 发送失败时处理器还留在列表中，移除时会以NotDelivered结束等待
+    if(sent == false)
+        m_manager->removeHandling(token);
+    m_sending = false;
+    // 发送期间已经得到结果时不挂起
+    return m_completed == false;
+}
+
+void RequestAwaitable::complete() noexcept
+{
+    m_completed = true;
+    if(m_sending == false)
+        m_handle.resume();
+}
+
+void DetachedTask::promise_type::unhandled_exception() noexcept
+{
+    try {
+        throw;
+    }
+    catch(const std::exception& e) {
+        coap_log_warn("Unhandled exception in coroutine: %s\n", e.what());
+    }
+    catch(...) {
+        coap_log_warn("Unhandled unknown exception in coroutine.\n");
+    }
+}
+
+} // namespace CoapPlusPlus
@@ -0,0 +1,125 @@
+/**
+ * @file RequestAwaitable.h
+ * @author Hulu
+ * @brief 基于C++20协程的请求等待体定义
+ * @version 0.1
+ * @date 2023-08-31
+ *
+ * @copyright Copyright (c) 2023
+ *
+ */
+#pragma once
+
+#include "coap/Handling.h"
+#include "coap/Pdu/RequestPdu.h"
+#include "coap/Pdu/ResponsePdu.h"
+#include <coroutine>
+#include <optional>
+
+namespace CoapPlusPlus
+{
+
+class SendersManager;
+
+/**
+ * @brief co_await SendersManager::request()得到的结果
+ *
+ */
+struct RequestResult
+{
+    /**
+     * @brief 收到的响应，未正常应答时为空
+     * @note 响应指向libcoap收到的报文，只在协程下一次挂起(co_await)或者结束之前有效，需要保留的数据请及时复制
+     */
+    std::optional<ResponsePdu> response;
+
+    /**
+     * @brief 未正常应答的原因，收到响应时为空
+     *
+     */
+    std::optional<Handling::NAckReason> nackReason;
+
+    /**
+     * @brief 是否收到了响应
+     *
+     */
+    bool isAck() const noexcept { return response.has_value(); }
+};
+
+/**
+ * @brief SendersManager::request()返回的等待体，co_await时发送请求并挂起协程，
+ *        收到响应或者未正常应答时直接在SendersManager的响应回调中恢复协程。
+ *
+ * @note 等待体保存在协程帧中，只能被co_await一次。
+ *       协程需要在进行网络I/O的线程中运行，与SendersManager::send()的要求一致。
+ * @see SendersManager::request()
+ */
+class RequestAwaitable
+{
+    RequestAwaitable& operator=(const RequestAwaitable&) = delete;
+    RequestAwaitable& operator=(RequestAwaitable&&) = delete;
+    RequestAwaitable(const RequestAwaitable&) = delete;
+    RequestAwaitable(RequestAwaitable&&) = delete;
+public:
+    bool await_ready() const noexcept { return false; }
+
+    /**
+     * @brief 发送请求并挂起协程
+     *
+     * @return 是否挂起，发送失败或者在发送过程中已经得到结果时返回false，协程继续执行
+     * @exception AlreadyExistException 已经存在相同token的处理器，异常会在协程中重新抛出
+     */
+    bool await_suspend(std::coroutine_handle<> handle);
+
+    RequestResult await_resume() noexcept { return std::move(m_result); }
+
+private:
+    friend class SendersManager;
+    class AwaitHandling;
+
+    RequestAwaitable(SendersManager& manager, RequestPdu pdu) noexcept;
+
+    /**
+     * @brief 保存结果，发送已经结束时恢复协程
+     *
+     */
+    void complete() noexcept;
+
+private:
+    SendersManager* m_manager;
+    RequestPdu m_pdu;
+    RequestResult m_result;
+    std::coroutine_handle<> m_handle;
+    bool m_sending = false;
+    bool m_completed = false;
+};
+
+/**
+ * @brief 一个最简单的协程返回类型，协程创建后立刻运行，结束时自动销毁协程帧，调用者不需要等待它。
+ *
+ * @code {.cpp}
+ * DetachedTask fetch(SendersManager& manager)
+ * {
+ *     auto first = co_await manager.request(manager.createRequest(Confirmable, Get));
+ *     if(first.isAck() == false)
+ *         co_return;
+ *     auto second = co_await manager.request(manager.createRequest(Confirmable, Put));
+ *     ...
+ * }
+ * @endcode
+ *
+ * @note 协程中未捕获的异常会被记录后忽略
+ */
+struct DetachedTask
+{
+    struct promise_type
+    {
+        DetachedTask get_return_object() noexcept { return {}; }
+        std::suspend_never initial_suspend() noexcept { return {}; }
+        std::suspend_never final_suspend() noexcept { return {}; }
+        void return_void() noexcept { }
+        void unhandled_exception() noexcept;
+    };
+};
+
+} // namespace CoapPlusPlus
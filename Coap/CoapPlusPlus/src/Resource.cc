@@ -1,12 +1,15 @@
 #include <coap3/coap.h> 
 #include "Resource.h"
 #include "ResourceInterface.h"
-#include "coap/Session.h"
+#include "Context.h"
+#include "ContextServer.h"
+#include "coap/SessionView.h"
 #include "coap/exception.h"
 #include "coap/Pdu/RequestPdu.h"
 #include "coap/Pdu/ResponsePdu.h"
 
 #include <string>
+#include <utility>
 namespace CoapPlusPlus
 {
 
@@ -19,6 +22,9 @@ Resource::Resource(const std::string& uriPath, bool observable) noexcept
 Resource::~Resource() noexcept
 {
     freeResource();
+    // 等待工作线程中使用回应接口的请求结束
+    for(auto running = m_asyncRunning.load(); running != 0; running = m_asyncRunning.load())
+        m_asyncRunning.wait(running);
     for(auto iter = m_resourceInterface.begin(); iter != m_resourceInterface.end(); ++iter) {
         delete iter->second;
     }
@@ -42,9 +48,17 @@ bool Resource::enableNotificationMessageConfirmable(bool enable) noexcept
 
 void Resource::notifyObserver() noexcept
 {
-    // 通知所有观察者
-    if(m_resource)
-        coap_resource_notify_observers(m_resource, nullptr);
+    // libcoap的观察者状态只能在进行网络I/O的线程中修改，通知交给该线程发出
+    if(m_context)
+        static_cast<ContextServer*>(m_context)->queueNotification(m_uriPath);
+}
+
+bool Resource::enableAsynchronous(bool enable) noexcept
+{
+    if(m_isInit)
+        return false;
+    m_asynchronous = enable;
+    return true;
 }
 
 void Resource::registerInterface(std::unique_ptr<ResourceInterface> resourceInterface)
@@ -64,17 +78,25 @@ void Resource::getRequestCallback(coap_resource_t* resource, coap_session_t* ses
 {
     // 处理 GET 请求
     auto resourceWrapper = static_cast<Resource*>(coap_resource_get_userdata(resource));
+    if(resourceWrapper != nullptr && resourceWrapper->interceptRequest(Information::RequestCode::Get, session, request, query, response)) {
+        return;
+    }
     if(resourceWrapper != nullptr) {
-        try {
-            auto imp = resourceWrapper->getResourceInterface(Information::RequestCode::Get);
-            
-            auto string = query == nullptr ? "" : std::string((const char*)query->s, query->length);
-            auto token = coap_pdu_get_token(request); // 如果请求没有token，虽然长度为0的，data是null但是token不为空，所以BinaryConst::Create不会抛出异常
-            imp->onRequest(Session(session,false), string, response, RequestPdu(const_cast<coap_pdu_t*>(request), BinaryConst::Create(token.length, token.s)));
-        } catch(std::exception& e) {
-            coap_log_warn("Resource::getRequestCallback error: %s, path:%s\n", e.what(), resourceWrapper->getUriPath().c_str());
+        // 未注册回应接口的请求码是常见情况，直接回应5.01，不经过异常
+        auto imp = resourceWrapper->tryGetResourceInterface(Information::RequestCode::Get);
+        if(imp == nullptr) {
             coap_pdu_set_code(response, static_cast<coap_pdu_code_t>(Information::NotImplemented));
         }
+        else {
+            try {
+                auto string = query == nullptr ? "" : std::string((const char*)query->s, query->length);
+                auto token = coap_pdu_get_token(request); // 请求报文在回调期间有效，token直接引用报文中的数据，不复制
+                imp->onRequest(SessionView(session), std::move(string), response, RequestPdu(const_cast<coap_pdu_t*>(request), BinaryConst::Reference(&token)));
+            } catch(std::exception& e) {
+                coap_log_warn("Resource::getRequestCallback error: %s, path:%s\n", e.what(), resourceWrapper->getUriPath().c_str());
+                coap_pdu_set_code(response, static_cast<coap_pdu_code_t>(Information::NotImplemented));
+            }
+        }
     }
     coap_show_pdu(LOG_DEBUG, request);
     coap_show_pdu(LOG_DEBUG, response);
@@ -85,16 +107,25 @@ void Resource::putRequestCallback(coap_resource_t* resource, coap_session_t* ses
 {
     // 处理 PUT 请求
     auto resourceWrapper = static_cast<Resource*>(coap_resource_get_userdata(resource));
+    if(resourceWrapper != nullptr && resourceWrapper->interceptRequest(Information::RequestCode::Put, session, request, query, response)) {
+        return;
+    }
     if(resourceWrapper != nullptr) {
-        try {
-            auto imp = resourceWrapper->getResourceInterface(Information::RequestCode::Put);
-            auto string = query == nullptr ? "" : std::string((const char*)query->s, query->length);
-            auto token = coap_pdu_get_token(request);
-            imp->onRequest(session, string, response, RequestPdu(const_cast<coap_pdu_t*>(request), BinaryConst::Create(token.length, token.s)));
-        } catch(std::exception& e) {
-            coap_log_warn("Resource::putRequestCallback error: %s, path:%s\n", e.what(), resourceWrapper->getUriPath().c_str());
+        // 未注册回应接口的请求码是常见情况，直接回应5.01，不经过异常
+        auto imp = resourceWrapper->tryGetResourceInterface(Information::RequestCode::Put);
+        if(imp == nullptr) {
             coap_pdu_set_code(response, static_cast<coap_pdu_code_t>(Information::NotImplemented));
         }
+        else {
+            try {
+                auto string = query == nullptr ? "" : std::string((const char*)query->s, query->length);
+                auto token = coap_pdu_get_token(request);
+                imp->onRequest(SessionView(session), std::move(string), response, RequestPdu(const_cast<coap_pdu_t*>(request), BinaryConst::Reference(&token)));
+            } catch(std::exception& e) {
+                coap_log_warn("Resource::putRequestCallback error: %s, path:%s\n", e.what(), resourceWrapper->getUriPath().c_str());
+                coap_pdu_set_code(response, static_cast<coap_pdu_code_t>(Information::NotImplemented));
+            }
+        }
     }
     coap_show_pdu(LOG_DEBUG, request);
     coap_show_pdu(LOG_DEBUG, response);
@@ -105,16 +136,25 @@ void Resource::postRequestCallback(coap_resource_t* resource, coap_session_t* se
 {
     // 处理 POST 请求
     auto resourceWrapper = static_cast<Resource*>(coap_resource_get_userdata(resource));
+    if(resourceWrapper != nullptr && resourceWrapper->interceptRequest(Information::RequestCode::Post, session, request, query, response)) {
+        return;
+    }
     if(resourceWrapper != nullptr) {
-        try {
-            auto imp = resourceWrapper->getResourceInterface(Information::RequestCode::Post);
-            auto string = query == nullptr ? "" : std::string((const char*)query->s, query->length);
-            auto token = coap_pdu_get_token(request);
-            imp->onRequest(session, string, response, RequestPdu(const_cast<coap_pdu_t*>(request), BinaryConst::Create(token.length, token.s)));
-        } catch(std::exception& e) {
-            coap_log_warn("Resource::postRequestCallback error: %s, path:%s\n", e.what(), resourceWrapper->getUriPath().c_str());
+        // 未注册回应接口的请求码是常见情况，直接回应5.01，不经过异常
+        auto imp = resourceWrapper->tryGetResourceInterface(Information::RequestCode::Post);
+        if(imp == nullptr) {
             coap_pdu_set_code(response, static_cast<coap_pdu_code_t>(Information::NotImplemented));
         }
+        else {
+            try {
+                auto string = query == nullptr ? "" : std::string((const char*)query->s, query->length);
+                auto token = coap_pdu_get_token(request);
+                imp->onRequest(SessionView(session), std::move(string), response, RequestPdu(const_cast<coap_pdu_t*>(request), BinaryConst::Reference(&token)));
+            } catch(std::exception& e) {
+                coap_log_warn("Resource::postRequestCallback error: %s, path:%s\n", e.what(), resourceWrapper->getUriPath().c_str());
+                coap_pdu_set_code(response, static_cast<coap_pdu_code_t>(Information::NotImplemented));
+            }
+        }
     }
     coap_show_pdu(LOG_DEBUG, request);
     coap_show_pdu(LOG_DEBUG, response);
@@ -125,16 +165,25 @@ void Resource::deleteRequestCallback(coap_resource_t* resource, coap_session_t*
 {
     // 处理 DELETE 请求
     auto resourceWrapper = static_cast<Resource*>(coap_resource_get_userdata(resource));
+    if(resourceWrapper != nullptr && resourceWrapper->interceptRequest(Information::RequestCode::Delete, session, request, query, response)) {
+        return;
+    }
     if(resourceWrapper != nullptr) {
-        try {
-            auto imp = resourceWrapper->getResourceInterface(Information::RequestCode::Delete);
-            auto string = query == nullptr ? "" : std::string((const char*)query->s, query->length);
-            auto token = coap_pdu_get_token(request);
-            imp->onRequest(session, string, response, RequestPdu(const_cast<coap_pdu_t*>(request), BinaryConst::Create(token.length, token.s)));
-        } catch(std::exception& e) {
-            coap_log_warn("Resource::deleteRequestCallback error: %s, path:%s\n", e.what(), resourceWrapper->getUriPath().c_str());
+        // 未注册回应接口的请求码是常见情况，直接回应5.01，不经过异常
+        auto imp = resourceWrapper->tryGetResourceInterface(Information::RequestCode::Delete);
+        if(imp == nullptr) {
             coap_pdu_set_code(response, static_cast<coap_pdu_code_t>(Information::NotImplemented));
         }
+        else {
+            try {
+                auto string = query == nullptr ? "" : std::string((const char*)query->s, query->length);
+                auto token = coap_pdu_get_token(request);
+                imp->onRequest(SessionView(session), std::move(string), response, RequestPdu(const_cast<coap_pdu_t*>(request), BinaryConst::Reference(&token)));
+            } catch(std::exception& e) {
+                coap_log_warn("Resource::deleteRequestCallback error: %s, path:%s\n", e.what(), resourceWrapper->getUriPath().c_str());
+                coap_pdu_set_code(response, static_cast<coap_pdu_code_t>(Information::NotImplemented));
+            }
+        }
     }
     coap_show_pdu(LOG_DEBUG, request);
     coap_show_pdu(LOG_DEBUG, response);
@@ -173,13 +222,47 @@ void Resource::freeResource() noexcept
     }
 }
 
-ResourceInterface *Resource::getResourceInterface(Information::RequestCode requestCode)
+ResourceInterface *Resource::tryGetResourceInterface(Information::RequestCode requestCode) const noexcept
 {
     auto iter = m_resourceInterface.find(requestCode);
-    if(iter == m_resourceInterface.end()) {
-        throw TargetNotFoundException("ResourceInterface not found");
+    return iter == m_resourceInterface.end() ? nullptr : iter->second;
+}
+
+bool Resource::interceptRequest(Information::RequestCode requestCode, coap_session_t* session,
+    const coap_pdu_t* request, const coap_string_t* query, coap_pdu_t* response) noexcept
+{
+    // 返回true表示请求已经由协议栈处理，不再同步调用回应接口
+    if(m_context == nullptr)
+        return false;
+    auto server = static_cast<ContextServer*>(m_context);
+    if(m_asynchronous) {
+        // 工作线程处理完成后，libcoap会用保存的请求再次调用回调函数，排空期间也要发送这些响应
+        auto async = coap_find_async(session, coap_pdu_get_token(request));
+        if(async != nullptr) {
+            server->completeAsyncRequest(session, async, response);
+            return true;
+        }
+    }
+    if(server->isDraining()) {
+        server->rejectRequest(response, Information::ServiceUnavailable, server->m_drainRetrySeconds);
+        return true;
     }
-    return iter->second;
+    // 在调用回应接口(包括提交给工作线程)之前限流
+    if(server->admitRequest(this, session, response) == false)
+        return true;
+    if(m_asynchronous == false)
+        return false;
+    auto imp = tryGetResourceInterface(requestCode);
+    if(imp == nullptr)
+        return false;
+    // 启动失败时退回到同步处理
+    return server->startAsyncRequest(this, imp, session, request, query);
+}
+
+void Resource::asyncRequestFinished() noexcept
+{
+    m_asyncRunning--;
+    m_asyncRunning.notify_all();
 }
 
 } // namespace CoapPlusPlus
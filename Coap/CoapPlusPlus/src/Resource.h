@@ -14,6 +14,7 @@
 #include <string>
 #include <memory>
 #include <map>
+#include <atomic>
 
 struct coap_resource_t;
 struct coap_session_t;
@@ -21,10 +22,12 @@ struct coap_pdu_t;
 struct coap_string_t;
 namespace CoapPlusPlus
 {
+class Context;
 class ResourceInterface;
 class Resource
 {
     friend class ResourceManager;
+    friend class ContextServer;
     Resource& operator=(const Resource&) = delete;
     Resource& operator=(Resource&&) = delete;
     Resource(const Resource&) = delete;
@@ -61,9 +64,35 @@ public:
     /**
      * @brief 对资源的所有观察者发送观察包
      * 
+     * @note 可以在任意线程中调用。通知先进入队列并唤醒Context的网络I/O，由进行网络I/O的线程在下一次处理开始时
+     *       标记资源并发送通知；资源在此之前被注销时通知被丢弃。资源未注册时什么也不做
      */
     void notifyObserver() noexcept;
 
+    /**
+     * @brief 设置资源是否以异步方式处理请求，默认为同步
+     * @details 同步方式下，回应接口在网络I/O的线程中被调用，一个耗时的回应接口会阻塞该Context上所有对等体的通信。
+     *          异步方式下，收到请求后立刻回应一个空的ACK，回应接口在ContextServer的工作线程池中被调用，
+     *          处理完成后再把回应作为独立的响应(Separate Response)发送给对等体。
+     * 
+     * @param enable 是否以异步方式处理请求
+     * @return 是否设置成功
+     *      @retval false 资源已经被注册，只能在注册前设置
+     * 
+     * @note 异步方式下回应接口在工作线程中被调用，传入的是只读的会话视图(SessionView::isReadOnly())，
+     *       读取的是进入工作线程前复制的会话信息，修改会话参数不起作用
+     * @see ContextServer::setAsyncWorkerCount(size_t count)
+     */
+    bool enableAsynchronous(bool enable) noexcept;
+
+    /**
+     * @brief 获取资源是否以异步方式处理请求
+     * 
+     * @return true 异步
+     * @return false 同步
+     */
+    bool isAsynchronous() const noexcept { return m_asynchronous; }
+
     /**
      * @brief 注册资源的回应接口，当收到请求时，会调用该接口。
      * 
@@ -90,13 +119,21 @@ private:
     coap_resource_t* getResource() const noexcept { return m_resource; }  
     void freeResource() noexcept; // ResourceManager调用
 
-    ResourceInterface* getResourceInterface(Information::RequestCode requestCode);
+    ResourceInterface* tryGetResourceInterface(Information::RequestCode requestCode) const noexcept; // 未注册时返回nullptr
+
+    bool interceptRequest(Information::RequestCode requestCode, coap_session_t* session,
+        const coap_pdu_t* request, const coap_string_t* query, coap_pdu_t* response) noexcept;
+    void asyncRequestStarted() noexcept { m_asyncRunning++; }   // ContextServer调用
+    void asyncRequestFinished() noexcept;                       // ContextServer的工作线程调用
 
 private:
     coap_resource_t* m_resource = nullptr;
+    Context* m_context = nullptr;   // 资源注册到的Context，由ResourceManager设置
     std::string m_uriPath;
     bool m_observable = false;
     bool m_isInit = false;
+    bool m_asynchronous = false;
+    std::atomic<int> m_asyncRunning = 0;  // 正在工作线程中执行的请求数量
     std::map<Information::RequestCode, ResourceInterface*> m_resourceInterface;
 };
 
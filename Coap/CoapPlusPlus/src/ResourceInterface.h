@@ -17,7 +17,7 @@ namespace CoapPlusPlus
 {
 
 class Resource;
-class Session;
+class SessionView;
 class ResponsePdu;
 class RequestPdu;
 class ResourceInterface
@@ -34,12 +34,15 @@ public:
     /**
      * @brief 当收到请求时，资源自动调用该接口进行回应
      * 
-     * @param session 会话信息
+     * @param session 会话视图，只在回调期间有效
      * @param query 查询字符串
      * @param request 请求信息
      * @param response 回应信息
+     * 
+     * @note request与response只在回调期间有效，request的token直接引用请求报文中的数据，
+     *       需要在回调之后使用时请用token().toBinaryConst()复制
      */
-    virtual void onRequest(Session session, std::string query, 
+    virtual void onRequest(SessionView session, std::string query, 
                         ResponsePdu response, RequestPdu request) = 0;
 
     /**
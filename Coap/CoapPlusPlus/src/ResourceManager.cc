@@ -26,6 +26,7 @@ bool ResourceManager::registerResource(std::unique_ptr<Resource> resource) noexc
         if (m_resources.find(uriPath) == m_resources.end()) {
             if (resource->initResource() ) {
                 coap_add_resource(_context.getContext(), resource->getResource());
+                resource->m_context = &_context;
                 m_resources[uriPath] = resource.release();
                 return true;
             }else
@@ -48,4 +49,23 @@ bool ResourceManager::unregisterResource(const std::string& uriPath) noexcept
         return false;
 }
 
+bool ResourceManager::notifyInIOThread(const std::string& uriPath) noexcept
+{
+    // 资源可能在通知排队期间被注销
+    auto it = m_resources.find(uriPath);
+    if (it == m_resources.end())
+        return false;
+    coap_resource_notify_observers(it->second->getResource(), nullptr);
+    return true;
+}
+
+void ResourceManager::notifyObservers(std::span<const std::string> uriPaths) noexcept
+{
+    // 资源在网络I/O的线程中查找和标记，这里不访问m_resources
+    for (auto& uriPath : uriPaths)
+        _context.queueNotification(uriPath, false);
+    if (uriPaths.empty() == false)
+        _context.wakeup();
+}
+
 } // namespace CoapPlusPlus
@@ -11,6 +11,7 @@
 #pragma once
 
 #include "ContextServer.h"
+#include <span>
 
 namespace CoapPlusPlus
 {
@@ -23,6 +24,7 @@ class Resource;
  */
 class ResourceManager
 {
+    friend class ContextServer;
     ResourceManager(const ResourceManager&) = delete;
     ResourceManager(ResourceManager&&) = delete;
     ResourceManager& operator=(const ResourceManager&) = delete;
@@ -57,6 +59,21 @@ public:
      */
     bool unregisterResource(const std::string& uriPath) noexcept;
 
+    /**
+     * @brief 批量通知多个资源的观察者，所有通知排队后只唤醒一次网络I/O
+     * @details 逐个调用Resource::notifyObserver()时每个资源都会唤醒一次网络I/O，
+     *          同一时刻更新大量资源时使用该函数，所有通知在下一次网络I/O处理中一起发送。
+     * 
+     * @param uriPaths 资源的URI路径列表，未注册的资源在网络I/O的线程中被忽略
+     * 
+     * @note 可以在任意线程中调用
+     * @see Resource::notifyObserver()
+     */
+    void notifyObservers(std::span<const std::string> uriPaths) noexcept;
+
+private:
+    bool notifyInIOThread(const std::string& uriPath) noexcept;   // ContextServer在网络I/O的线程中调用
+
 private:
     ContextServer& _context;
     std::map<std::string, Resource*> m_resources;
@@ -0,0 +1,61 @@
+#include <coap3/coap.h>
+#include "Response.h"
+#include "coap/exception.h"
+#include <stdexcept>
+#include <utility>
+
+namespace CoapPlusPlus
+{
+
+Response::Response(coap_pdu_t* pdu)
+    : m_status(Ack)
+{
+    if(pdu == nullptr)
+        throw std::invalid_argument("pdu is nullptr");
+    m_rawPdu = pdu;
+    m_pdu.emplace(pdu);
+}
+
+Response::Response(Status status, Handling::NAckReason reason) noexcept
+    : m_status(status), m_reason(reason)
+{
+}
+
+Response::Response(Response&& other) noexcept
+    : m_status(other.m_status)
+    , m_reason(other.m_reason)
+    , m_rawPdu(std::exchange(other.m_rawPdu, nullptr))
+    , m_pdu(std::move(other.m_pdu))
+{
+    other.m_pdu.reset();
+}
+
+Response& Response::operator=(Response&& other) noexcept
+{
+    if(this != &other) {
+        if(m_rawPdu)
+            coap_delete_pdu(m_rawPdu);
+        m_status = other.m_status;
+        m_reason = other.m_reason;
+        m_rawPdu = std::exchange(other.m_rawPdu, nullptr);
+        m_pdu = std::move(other.m_pdu);
+        other.m_pdu.reset();
+    }
+    return *this;
+}
+
+Response::~Response() noexcept
+{
+    m_pdu.reset();
+    if(m_rawPdu)
+        coap_delete_pdu(m_rawPdu);
+}
+
+const ResponsePdu& Response::pdu() const
+{
+    if(m_pdu.has_value() == false)
+        throw DataNotReadyException("No response was received.");
+    return m_pdu.value();
+}
+
+} // namespace CoapPlusPlus
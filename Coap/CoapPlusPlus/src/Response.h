@@ -0,0 +1,86 @@
+/**
+ * @file Response.h
+ * @author Hulu
+ * @brief 持有响应报文的请求结果定义
+ * @version 0.1
+ * @date 2023-09-01
+ *
+ * @copyright Copyright (c) 2023
+ *
+ */
+#pragma once
+
+#include "coap/Handling.h"
+#include "coap/Pdu/ResponsePdu.h"
+#include <optional>
+
+struct coap_pdu_t;
+
+namespace CoapPlusPlus
+{
+
+/**
+ * @brief 一个请求的最终结果，持有响应报文的副本，可以在任意线程中、任意时间读取
+ * @see SendersManager::sendFuture()
+ */
+class Response
+{
+    Response& operator=(const Response&) = delete;
+    Response(const Response&) = delete;
+public:
+    enum Status {
+        Ack = 0,    // 收到了响应
+        NAck,       // 未正常应答，原因见nackReason()
+        Timeout,    // 超过了调用者指定的期限仍未收到响应
+    };
+
+    /**
+     * @brief 构造一个收到响应的结果
+     *
+     * @param pdu 响应报文的副本，生命周期由Response管理
+     * @exception std::invalid_argument 当传入的pdu为空时抛出
+     */
+    explicit Response(coap_pdu_t* pdu);
+
+    /**
+     * @brief 构造一个未收到响应的结果
+     *
+     * @param status NAck或者Timeout
+     * @param reason 未正常应答的原因，status为Timeout时没有意义
+     */
+    Response(Status status, Handling::NAckReason reason) noexcept;
+
+    Response(Response&& other) noexcept;
+    Response& operator=(Response&& other) noexcept;
+    ~Response() noexcept;
+
+    Status status() const noexcept { return m_status; }
+
+    /**
+     * @brief 是否收到了响应
+     *
+     */
+    bool isAck() const noexcept { return m_status == Ack; }
+
+    /**
+     * @brief 获取响应报文
+     *
+     * @return 响应报文，与Response的生命周期一致
+     * @exception DataNotReadyException 没有收到响应
+     */
+    const ResponsePdu& pdu() const;
+
+    /**
+     * @brief 获取未正常应答的原因，只有status()为NAck时有意义
+     *
+     */
+    Handling::NAckReason nackReason() const noexcept { return m_reason; }
+
+private:
+    Status m_status;
+    Handling::NAckReason m_reason = Handling::NotDelivered;
+    coap_pdu_t* m_rawPdu = nullptr;
+    std::optional<ResponsePdu> m_pdu;
+};
+
+} // namespace CoapPlusPlus
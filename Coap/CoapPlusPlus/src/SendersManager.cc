@@ -1,27 +1,29 @@
 #include "SendersManager.h"
 #include "SendersManagerHandlerWrapper.h"
 #include "DefaultHandling.h"
+#include "FutureHandling.h"
 #include "coap/exception.h"
 #include "coap/DataStruct/BinaryConstView.h"
 #include "coap/Pdu/RequestPdu.h"
 #include "coap/Pdu/ResponsePdu.h"
 #include "coap/Session.h"
 #include "coap/Handling.h"
+#include "coap/Context.h"
 namespace CoapPlusPlus
 {
 
 SendersManager::SendersManager(coap_session_t &coap_session)
     : m_coap_session(&coap_session)
 {
-    registerHandlerInit();
+    defaultHandlingInit();
 }
 
 SendersManager::~SendersManager()
 {
-    for (auto iter = m_handlings.begin(); iter != m_handlings.end(); ++iter) {
-        iter->second->readyDestroyed();
-        delete iter->second;
-    }
+    m_handlings.forEach([](Handling* handling) {
+        handling->readyDestroyed();
+        delete handling;
+    });
     m_handlings.clear();
     if (m_defaultHandling) {
         m_defaultHandling->readyDestroyed();
@@ -30,14 +32,22 @@ SendersManager::~SendersManager()
 }
 
 bool SendersManager::send(RequestPdu pdu, std::unique_ptr<Handling> handling)
+{
+    auto result = sendWithoutWakeup(std::move(pdu), std::move(handling));
+    if (result)
+        wakeupContext();
+    return result;
+}
+
+bool SendersManager::sendWithoutWakeup(RequestPdu pdu, std::unique_ptr<Handling> handling)
 {
     auto coap_pdu = pdu.getPdu();
-    std::shared_ptr<BinaryConst> token = nullptr;
+    auto token = pdu.token();
     try{
         if (coap_pdu == nullptr || m_coap_session == nullptr) {
             throw InternalException("pdu or session is nullptr");
         }
-        token = std::make_shared<BinaryConst>(std::move(pdu.token().toBinaryConst()));
+        token.size();   // token已经被释放时抛出异常
     } catch (std::exception& e) {
         if (handling.get() != nullptr) {
             handling->readyDestroyed();
@@ -48,28 +58,90 @@ bool SendersManager::send(RequestPdu pdu, std::unique_ptr<Handling> handling)
     }   
     
     if (handling.get() != nullptr) {
-        if (handling->token() != pdu.token()) {
+        if (handling->token() != token) {
             handling->readyDestroyed();
             handling.reset();
             //coap_log_warn("send: handling token is not equal to pdu token\n");
             throw std::invalid_argument("handling token is not equal to pdu token");
         }
-        auto iter = m_handlings.find(*token);
-        if (iter != m_handlings.end()) {
+        TokenTable<Handling>::Key key;
+        if (MakeKey(token, key) == false) {
+            handling->readyDestroyed();
+            handling.reset();
+            throw std::invalid_argument("token with a handling must not be longer than 8 bytes");
+        }
+        if (m_handlings.find(key) != nullptr) {
             std::string error = std::string("The Handling for this token(")
-                                + std::string(token->data().begin(), token->data().end()) 
+                                + std::string(token.data().begin(), token.data().end()) 
                                 + std::string(") already exists");
             handling->readyDestroyed();
             handling.reset();
             //coap_log_warn("send: %s\n", error.c_str());
             throw AlreadyExistException(error.c_str());
         }
-        m_handlings.insert(std::make_pair(BinaryConst(*token), handling.release()));
+        try {
+            m_handlings.insert(key, handling.get());
+        } catch (std::exception& e) {
+            handling->readyDestroyed();
+            handling.reset();
+            coap_log_warn("send: %s\n", e.what());
+            return false;
+        }
+        handling.release();
     }
     auto mid = coap_send(m_coap_session, coap_pdu);
     return mid != COAP_INVALID_MID;
 }
 
+void SendersManager::wakeupContext() noexcept
+{
+    auto context = static_cast<Context*>(coap_get_app_data(coap_session_get_context(m_coap_session)));
+    if(context)
+        context->wakeup();
+}
+
+std::future<Response> SendersManager::sendFuture(RequestPdu pdu, int timeoutMs)
+{
+    std::promise<Response> promise;
+    auto future = promise.get_future();
+    sendPromise(std::move(pdu), std::move(promise), timeoutMs);
+    wakeupContext();
+    return future;
+}
+
+bool SendersManager::sendPromise(RequestPdu pdu, std::promise<Response> promise, int timeoutMs)
+{
+    auto token = pdu.token().toBinaryConst();
+    auto handling = std::make_unique<FutureHandling>(token, m_coap_session, std::move(promise));
+    auto futureHandling = handling.get();
+    if (sendWithoutWakeup(std::move(pdu), std::move(handling)) == false) {
+        // 发送失败时处理器可能还在列表中，移除时以NAck结束
+        removeHandling(token);
+        return false;
+    }
+    TokenTable<Handling>::Key key;
+    if (timeoutMs <= 0 || MakeKey(token, key) == false || m_handlings.find(key) == nullptr)
+        return true;
+    auto context = static_cast<Context*>(coap_get_app_data(coap_session_get_context(m_coap_session)));
+    if (context == nullptr) {
+        coap_log_warn("sendPromise: context not found, the deadline is ignored\n");
+        return true;
+    }
+    auto id = context->addTimer(timeoutMs, [this, key]() { expireHandling(key); });
+    futureHandling->setTimer(context, id);
+    return true;
+}
+
+void SendersManager::expireHandling(const TokenTable<Handling>::Key& key) noexcept
+{
+    auto handling = dynamic_cast<FutureHandling*>(m_handlings.find(key));
+    if (handling == nullptr)
+        return;
+    handling->expire();
+    m_handlings.erase(key);
+    handling->readyDestroyed();
+    delete handling;
+}
 
 void SendersManager::updateDefaultHandling(std::unique_ptr<Handling> handling) noexcept
 {
@@ -113,39 +185,54 @@ catch (std::exception &e)
 
 Handling* SendersManager::getHandling(const BinaryConstView &token) const
 {
-    auto t = token.toBinaryConst();
-    auto iter = m_handlings.find(t);
-    if (iter != m_handlings.end()) {
-        return iter->second;
-    }
-    else
+    auto handling = tryGetHandling(token);
+    if (handling == nullptr)
         throw TargetNotFoundException("Not found handling");
+    return handling;
 }
 
-void SendersManager::registerHandlerInit() noexcept
+Handling* SendersManager::tryGetHandling(const BinaryConstView &token) const noexcept
+{
+    TokenTable<Handling>::Key key;
+    if (MakeKey(token, key) == false)
+        return nullptr;
+    return m_handlings.find(key);
+}
+
+void SendersManager::defaultHandlingInit() noexcept
 {
-    auto coap_context = coap_session_get_context(m_coap_session);
-    coap_register_response_handler(coap_context, SendersManager::SendersManagerHandlerWrapper::AckHandler); 
-    coap_register_nack_handler(coap_context, SendersManager::SendersManagerHandlerWrapper::NackHandler);
     try {
         m_defaultHandling = new DefaultHandling(createToken());
     }catch(...) {
-        coap_log_warn("registerHandlerInit: internal error!\n");
+        coap_log_warn("defaultHandlingInit: internal error!\n");
     }
 }
 
+void SendersManager::RegisterContextHandlers(coap_context_t* coap_context) noexcept
+{
+    coap_register_response_handler(coap_context, SendersManager::SendersManagerHandlerWrapper::AckHandler); 
+    coap_register_nack_handler(coap_context, SendersManager::SendersManagerHandlerWrapper::NackHandler);
+}
+
 bool SendersManager::removeHandling(const BinaryConstView &token) noexcept
 {
-    auto t = token.toBinaryConst();
-    auto iter = m_handlings.find(t);
-    if (iter != m_handlings.end()) {
-        iter->second->readyDestroyed();
-        delete iter->second;
-        m_handlings.erase(iter);
-        return true;
-    } else {
+    TokenTable<Handling>::Key key;
+    if (MakeKey(token, key) == false)
         return false;
-    }
+    auto handling = m_handlings.erase(key);
+    if (handling == nullptr)
+        return false;
+    handling->readyDestroyed();
+    delete handling;
+    return true;
+}
+
+bool SendersManager::MakeKey(const BinaryConstView &token, TokenTable<Handling>::Key &key) noexcept
+try {
+    return TokenTable<Handling>::MakeKey(token.data(), key);
+} catch (std::exception &e) {
+    // token已经被释放
+    return false;
 }
 
 } // namespace CoapPlusPlus
\ No newline at end of file
@@ -11,10 +11,14 @@
 #pragma once
 
 #include "coap/Information/PduInformation.h"
-#include <map>
+#include "RequestAwaitable.h"
+#include "Response.h"
+#include "utils/TokenTable.h"
+#include <future>
 #include <memory>
 
 struct coap_session_t;
+struct coap_context_t;
 
 namespace CoapPlusPlus
 {
@@ -25,6 +29,8 @@ class BinaryConst;
 class Handling;
 class SendersManager
 {
+    friend class ContextClient;
+    friend class Context;
     SendersManager& operator=(const SendersManager&) = delete;
     SendersManager& operator=(SendersManager&&) = delete;
     SendersManager(const SendersManager&) = delete;
@@ -47,10 +53,74 @@ public:
      * @exception AlreadyExistException 已经存在相同token的处理器。
      *            如果更新处理器请使用removeHandling()函数删除旧的处理器，
      *            如果使用旧的处理器，传入nullptr即可。
-     * @exception std::invalid_argument handling中的token与pdu中的token不一致
+     * @exception std::invalid_argument handling中的token与pdu中的token不一致，或者传入了handling而token超过8个字节
      */
     bool send(RequestPdu pdu, std::unique_ptr<Handling> handling);
 
+    /**
+     * @brief 发送请求但不唤醒网络I/O，参数、返回值与异常同send()
+     * @details send()每发送一个请求都要唤醒一次网络I/O(一次write系统调用)。一次推送大量请求时，
+     *          逐个调用该函数，最后调用一次wakeupContext()。
+     * 
+     * @note 每个数据报仍由libcoap在coap_send()中单独发送
+     */
+    bool sendWithoutWakeup(RequestPdu pdu, std::unique_ptr<Handling> handling);
+
+    /**
+     * @brief 唤醒可能阻塞在其他线程中的网络I/O，让刚发送的请求的重传定时被重新计算
+     * 
+     */
+    void wakeupContext() noexcept;
+
+    /**
+     * @brief 在协程中发送请求并等待结果，不需要为每个请求编写Handling子类。
+     *        co_await时发送请求并挂起协程，收到响应或者未正常应答时在响应回调中直接恢复协程。
+     * 
+     * @code {.cpp}
+     * DetachedTask task(SendersManager& manager)
+     * {
+     *     auto result = co_await manager.request(manager.createRequest(MessageType::Confirmable, RequestCode::Get));
+     *     if(result.isAck())
+     *         Pdu::LogPdu(LOG_LEVEL::INFO, &result.response.value());
+     *     else
+     *         coap_log_info("%s\n", Handling::NAckReasonToString(result.nackReason.value()));
+     * }
+     * @endcode
+     * 
+     * @param pdu 请求
+     * @return 等待体，co_await的结果为RequestResult @see RequestResult
+     * 
+     * @note 发送失败时协程不会挂起，结果为NotDelivered；
+     *       调用removeHandling()移除该请求的token或者SendersManager析构时，等待中的协程会以NotDelivered恢复。
+     *       协程恢复时仍处于libcoap的响应回调中，不要在其中销毁当前的Session。
+     */
+    RequestAwaitable request(RequestPdu pdu) noexcept { return RequestAwaitable(*this, std::move(pdu)); }
+
+    /**
+     * @brief 发送请求，通过std::future得到结果，适合同步等待结果的调用者
+     * 
+     * @code {.cpp}
+     * // I/O线程中发送
+     * auto future = manager.sendFuture(manager.createRequest(MessageType::Confirmable, RequestCode::Get), 2000);
+     * // 其他线程中等待
+     * auto response = future.get();
+     * if(response.isAck())
+     *     Pdu::LogPdu(LOG_LEVEL::INFO, &response.pdu());
+     * @endcode
+     * 
+     * @param pdu 请求
+     * @param timeoutMs 等待响应的期限，从发送时开始计算，与libcoap的重传时间无关；小于等于0表示不设期限，
+     *                  由libcoap的重传机制决定何时未正常应答
+     * @return 请求的结果 @see Response
+     *      - 收到响应时为Ack，结果中持有响应报文的副本
+     *      - 未正常应答或者发送失败时为NAck
+     *      - 期限已到时为Timeout，对应的处理器会被移除，token随之释放，之后迟到的响应交给默认的处理器
+     * 
+     * @exception AlreadyExistException 已经存在相同token的处理器
+     * @note 与send()一样需要在进行网络I/O的线程中调用，其他线程请使用ContextClient::submitFuture()
+     */
+    std::future<Response> sendFuture(RequestPdu pdu, int timeoutMs = 0);
+
     /**
      * @brief 更新默认的响应处理器，当send函数中没有指定处理器时或者传入nullptr是，内部使用默认的处理器
      * 
@@ -114,6 +184,16 @@ public:
      */
     Handling* getHandling(const BinaryConstView& token) const;
 
+    /**
+     * @brief 获取一个处理器，未找到时不抛出异常
+     * 
+     * @param token 
+     * @return 处理器对象，未找到对应的处理器时返回nullptr
+     * 
+     * @note 响应回调中使用该函数查找处理器，观察推送等没有对应处理器的响应很常见，不应当以异常的方式处理
+     */
+    Handling* tryGetHandling(const BinaryConstView& token) const noexcept;
+
     /**
      * @brief 移除一个处理器
      * 
@@ -124,14 +204,42 @@ public:
     bool removeHandling(const BinaryConstView& token) noexcept;
 
 private:
-    void registerHandlerInit() noexcept;
+    void defaultHandlingInit() noexcept;
+
+    /**
+     * @brief 为上下文注册响应和未应答的处理函数，由Context在构造时调用一次
+     * 
+     * @param coap_context libcoap上下文
+     */
+    static void RegisterContextHandlers(coap_context_t* coap_context) noexcept;
+
+    /**
+     * @brief 发送请求，结果写入promise，期限定时器在发送成功后启动
+     * 
+     * @return 是否发送成功，失败时promise已经写入NAck结果
+     */
+    bool sendPromise(RequestPdu pdu, std::promise<Response> promise, int timeoutMs);
+
+    /**
+     * @brief 请求的期限已到，以Timeout结果移除对应的处理器
+     * 
+     */
+    void expireHandling(const TokenTable<Handling>::Key& key) noexcept;
+
+    /**
+     * @brief 由token构造处理器表的键，不复制token
+     * 
+     * @return 是否构造成功，token已经被释放或者超过8个字节时失败
+     */
+    static bool MakeKey(const BinaryConstView& token, TokenTable<Handling>::Key& key) noexcept;
 
 private:
     class SendersManagerHandlerWrapper;
 
     coap_session_t *m_coap_session = nullptr;
-    std::map<BinaryConst, Handling*> m_handlings; 
+    TokenTable<Handling> m_handlings;   // token -> 处理器，处理器由SendersManager持有
     class DefaultHandling;
+    class FutureHandling;
     Handling* m_defaultHandling = nullptr;
 };
 
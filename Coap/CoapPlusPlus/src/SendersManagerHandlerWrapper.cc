@@ -22,19 +22,17 @@ try{
     auto coap_token = coap_pdu_get_token(sent);
     auto token = BinaryConstView(&coap_token);
     // 获取handling
-    Handling* handling;
+    auto handling = s->getSendersManager().tryGetHandling(token);
     bool isDefaultHandling = false;
-    try { handling = s->getSendersManager().getHandling(token); }
-    catch (TargetNotFoundException &e) { 
+    if (handling == nullptr) {
         handling = s->getSendersManager().m_defaultHandling; 
         isDefaultHandling = true;
-        if (handling == nullptr) {
-            std::string message = "internal error! default handling is nullptr and " + std::string(e.what());
-            throw std::runtime_error(message.c_str());
-        }
+        if (handling == nullptr)
+            throw std::runtime_error("internal error! default handling is nullptr and handling not found");
     }
 
-    auto pdu = RequestPdu(const_cast<coap_pdu_t*>(sent), BinaryConst::DeepCopy(&coap_token));
+    // 请求报文在回调期间有效，token直接引用报文中的数据
+    auto pdu = RequestPdu(const_cast<coap_pdu_t*>(sent), BinaryConst::Reference(&coap_token));
     handling->onNAck(*s, std::move(pdu), static_cast<Handling::NAckReason>(reason));
     if (handling->isFinished() && isDefaultHandling == false) {
         s->getSendersManager().removeHandling(token);
@@ -58,16 +56,13 @@ try{
     auto coap_response_token = coap_pdu_get_token(received);
     auto response_token = BinaryConstView(&coap_response_token);
     // 获取handling
-    Handling* handling;
+    auto handling = s->getSendersManager().tryGetHandling(response_token);
     bool isDefaultHandling = false;
-    try { handling = s->getSendersManager().getHandling(response_token); }
-    catch (TargetNotFoundException &e) { 
+    if (handling == nullptr) {
         handling = s->getSendersManager().m_defaultHandling; 
         isDefaultHandling = true;
-        if (handling == nullptr) {
-            std::string message = "internal error! default handling is nullptr and " + std::string(e.what());
-            throw std::runtime_error(message.c_str());
-        }
+        if (handling == nullptr)
+            throw std::runtime_error("internal error! default handling is nullptr and handling not found");
     }
 
     // 如果sent == nullptr，说明是一个非confirmable的请求，那么就不需要查找对应的request
@@ -87,12 +82,12 @@ try{
                                 + ")";
             throw std::runtime_error(message.c_str());
         }
-        auto request = RequestPdu(const_cast<coap_pdu_t*>(sent), BinaryConst::DeepCopy(&coap_request_token));
+        auto request = RequestPdu(const_cast<coap_pdu_t*>(sent), BinaryConst::Reference(&coap_request_token));
         
         handling->onAck(*s, &request, &response);
     }
     // 完成处理
-    if (handling->isFinished()) {
+    if (handling->isFinished() && isDefaultHandling == false) {
         s->getSendersManager().removeHandling(response_token);
     }
     return COAP_RESPONSE_OK;
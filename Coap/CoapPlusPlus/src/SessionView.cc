@@ -0,0 +1,150 @@
+#include <coap3/coap.h>
+#include "SessionView.h"
+#include "coap/exception.h"
+#include "coap/DataStruct/Address.h"
+
+namespace CoapPlusPlus
+{
+
+SessionSnapshot::SessionSnapshot(const coap_session_t* raw_session) noexcept
+{
+    SessionView view(const_cast<coap_session_t*>(raw_session));
+    protocol = view.getProtocol();
+    state = view.getSessionState();
+    try {
+        localAddress.emplace(view.getLocalAddress());
+    } catch(std::exception&) {}
+    try {
+        remoteAddress.emplace(view.getRemoteAddress());
+    } catch(std::exception&) {}
+    ackTimeout = view.getAckTimeout();
+    maxRetransmit = view.getMaxRetransmit();
+    nstart = view.getNSTART();
+    try {
+        context = view.getContext();
+    } catch(std::exception&) {
+        context = nullptr;
+    }
+}
+
+SessionView::SessionView(coap_session_t *raw_session) : m_session(raw_session)
+{
+    if(raw_session == nullptr)
+        throw std::invalid_argument("Failed to construct a new SessionView object, session is nullptr");
+}
+
+Information::Protocol SessionView::getProtocol() const noexcept
+{
+    if(m_snapshot)
+        return m_snapshot->protocol;
+    auto pro = coap_session_get_proto(m_session);
+    return static_cast<Information::Protocol>(pro);
+}
+
+Information::SessionState SessionView::getSessionState() const noexcept
+{
+    if(m_snapshot)
+        return m_snapshot->state;
+    auto state = coap_session_get_state(m_session);
+    return static_cast<Information::SessionState>(state);
+}
+
+Address SessionView::getLocalAddress() const
+{
+    if(m_snapshot) {
+        if(m_snapshot->localAddress.has_value() == false)
+            throw InternalException("Failed to call the Session::getLocalAddress()");
+        return *m_snapshot->localAddress;
+    }
+    auto raw_addr = coap_session_get_addr_local(m_session);
+    if(raw_addr == nullptr)
+        throw InternalException("Failed to call the Session::getLocalAddress()");
+    return Address(*raw_addr);
+}
+
+Address SessionView::getRemoteAddress() const
+{
+    if(m_snapshot) {
+        if(m_snapshot->remoteAddress.has_value() == false)
+            throw InternalException("Failed to call the Session::getRemoteAddress()");
+        return *m_snapshot->remoteAddress;
+    }
+    auto raw_addr = coap_session_get_addr_remote(m_session);
+    if(raw_addr == nullptr)
+        throw InternalException("Failed to call the Session::getRemoteAddress()");
+    return Address(*raw_addr);
+}
+
+float SessionView::getAckTimeout() const noexcept
+{
+    if(m_snapshot)
+        return m_snapshot->ackTimeout;
+    auto fixed = coap_session_get_ack_timeout(m_session);
+    return fixed.integer_part + fixed.fractional_part / 1000.f;
+}
+
+void SessionView::setAckTimeout(float seconds) noexcept
+{
+    if(m_snapshot) {
+        coap_log_warn("SessionView::setAckTimeout: the session view is read-only.\n");
+        return ;
+    }
+    coap_fixed_point_t fixed;
+    fixed.integer_part = static_cast<uint16_t>(seconds);
+    fixed.fractional_part = static_cast<uint16_t>((seconds - fixed.integer_part) * 1000);
+    coap_session_set_ack_timeout(m_session, fixed);
+}
+
+uint16_t SessionView::getMaxRetransmit() const noexcept
+{
+    if(m_snapshot)
+        return m_snapshot->maxRetransmit;
+    return coap_session_get_max_retransmit(m_session);
+}
+
+void SessionView::setMaxRetransmit(uint16_t value) noexcept
+{
+    if(m_snapshot) {
+        coap_log_warn("SessionView::setMaxRetransmit: the session view is read-only.\n");
+        return ;
+    }
+    if(value == 0)
+        return ;
+    coap_session_set_max_retransmit(m_session, value);
+}
+
+uint16_t SessionView::getNSTART() const noexcept
+{
+    if(m_snapshot)
+        return m_snapshot->nstart;
+    return coap_session_get_nstart(m_session);
+}
+
+void SessionView::setNSTART(uint16_t count) noexcept
+{
+    if(m_snapshot) {
+        coap_log_warn("SessionView::setNSTART: the session view is read-only.\n");
+        return ;
+    }
+    if(count == 0)
+        return ;
+    coap_session_set_nstart(m_session, count);
+}
+
+const Context *SessionView::getContext() const
+{
+    if(m_snapshot) {
+        if(m_snapshot->context == nullptr)
+            throw TargetNotFoundException("Failed to get the context, unable to find context");
+        return m_snapshot->context;
+    }
+    auto coap_context = coap_session_get_context(m_session);
+    if(coap_context == nullptr)
+        throw TargetNotFoundException("Failed to get the context, unable to find context");
+    auto context = static_cast<Context*>(coap_get_app_data(coap_context));
+    if(context == nullptr)
+        throw TargetNotFoundException("Failed to get the context, unable to find context");
+    return context;
+}
+
+} // namespace CoapPlusPlus
\ No newline at end of file
@@ -0,0 +1,197 @@
+/**
+ * @file SessionView.h
+ * @author Hulu
+ * @brief coap_session_t 的非持有视图定义
+ * @version 0.1
+ * @date 2023-09-04
+ *
+ * @copyright Copyright (c) 2023
+ *
+ */
+#pragma once
+
+#include <cstdint>
+#include <optional>
+#include "coap/Information/GeneralInformation.h"
+#include "coap/DataStruct/Address.h"
+
+struct coap_session_t;
+namespace CoapPlusPlus
+{
+
+class Context;
+
+/**
+ * @brief 会话信息的快照，在网络I/O的线程中复制，供异步资源的工作线程读取
+ * 
+ */
+struct SessionSnapshot
+{
+    /**
+     * @brief 复制会话的信息，只能在进行网络I/O的线程中调用
+     * 
+     * @param raw_session libcoap会话
+     */
+    explicit SessionSnapshot(const coap_session_t* raw_session) noexcept;
+
+    Information::Protocol protocol;
+    Information::SessionState state;
+    std::optional<Address> localAddress;    // 无法获取时为空
+    std::optional<Address> remoteAddress;   // 无法获取时为空
+    float ackTimeout;
+    uint16_t maxRetransmit;
+    uint16_t nstart;
+    const Context* context;                 // 无法获取时为nullptr
+};
+
+/**
+ * @brief 会话的轻量视图，只保存coap_session_t指针，不管理会话的生命周期，构造和复制都不会分配内存。
+ *        服务器资源回调、事件回调中传入的都是SessionView。
+ *
+ * @note 视图只在回调期间有效，回调返回后libcoap可能会释放会话，不要保存视图。
+ *       异步资源的工作线程中传入的是只读视图，读取的是进入工作线程前复制的快照，设置函数不起作用。
+ * @see Session
+ */
+class SessionView
+{
+public:
+    /**
+     * @brief Construct a new Session View object
+     *
+     * @param raw_session libcoap会话
+     *
+     * @exception invalid_argument raw_session 为空
+     */
+    explicit SessionView(coap_session_t* raw_session);
+
+    /**
+     * @brief 是否为只读视图，只读视图读取的是会话信息的快照，设置函数不起作用
+     * 
+     */
+    bool isReadOnly() const noexcept { return m_snapshot != nullptr; }
+
+    /**
+     * @brief 获取会话协议类型。
+     *
+     * @return 协议类型
+     *      @retval Information::Protocol::Udp UDP协议
+     *      @retval Information::Protocol::Tcp TCP协议
+     *      @retval Information::Protocol::Tls TLS协议
+     *      @retval Information::Protocol::Dtls DTLS协议
+     *      @retval Information::Protocol::None 未知协议
+     */
+    Information::Protocol getProtocol() const noexcept;
+
+    /**
+     * @brief 获取当前会话的状态
+     *
+     * @return 会话状态
+     *      @retval Information::SessionState::NoneState 会话未建立
+     *      @retval Information::SessionState::Connecting 正在连接中
+     *      @retval Information::SessionState::Handshaking 会话正在握手
+     *      @retval Information::SessionState::Csm 正在进行Csm交换
+     *      @retval Information::SessionState::Established 会话已建立
+     */
+    Information::SessionState getSessionState() const noexcept;
+
+    /**
+     * @brief 从会话中获取本地IP地址和端口。
+     *
+     * @return Address 保存了本地IP地址和端口的对象 @see Address
+     *
+     * @exception InternalException 内部错误，无法获取本地地址
+     */
+    Address getLocalAddress() const;
+
+    /**
+     * @brief 从会话中获取远程IP地址和端口。
+     *
+     * @return Address 保存了本地IP地址和端口的对象 @see Addresss
+     *
+     * @exception InternalException 内部错误，无法获取本地地址
+     * @note 对于客户端，当恢复组播地址时，在调用下一次coap_send()之前，这可能是组播请求的响应IP地址。
+     */
+    Address getRemoteAddress() const;
+
+    /**
+     * @brief 获取下一次重发前CoAP初始ACK响应超时。
+     * @see RFC7252 ACK_TIMEOUT
+     *
+     * @return 预期收到ACK或未收到CON报文的响应的秒数
+     */
+    float getAckTimeout() const noexcept;
+
+    /**
+     * @brief 设置下一次重发前CoAP初始ACK响应超时。
+     * @see RFC7252 ACK_TIMEOUT
+     *
+     * @param seconds 预期收到ACK或未收到CON报文的响应的秒数, 如果设置小于等于0，则会被设置为2.0
+     *
+     * @note 默认值为2.0秒，通常不应该更改这个值。只读视图中不起作用。
+     */
+    void setAckTimeout(float seconds) noexcept;
+
+    /**
+     * @brief 获取请求报文发送停止前的最大重传次数
+     * @see RFC7252 MAX_RETRANSMIT
+     *
+     * @return 当前最大重传次数
+     */
+    uint16_t getMaxRetransmit() const noexcept;
+
+    /**
+     * @brief 设置请求报文发送停止前的最大重传次数。
+     * @see RFC7252 MAX_RETRANSMIT
+     *
+     * @param value 停止发送报文前的报文重传次数
+     *
+     * @note 默认值为4次，通常不应该更改这个值。只读视图中不起作用。
+     */
+    void setMaxRetransmit(uint16_t value) noexcept;
+
+    /**
+     * @brief 获取会话与指定的服务器（包括代理）维持的未完成交互的数量，参见拥塞控制
+     * @see https://www.rfc-editor.org/rfc/rfc7252.html#section-4.7
+     *
+     * @return 返回数量，默认值为1个
+     */
+    uint16_t getNSTART() const noexcept;
+
+    /**
+     * @brief 设置会话与指定的服务器（包括代理）维持的未完成交互的数量，参见拥塞控制
+     * @see https://www.rfc-editor.org/rfc/rfc7252.html#section-4.7
+     *
+     * @param count 数量，默认值为1个
+     * @note 只读视图中不起作用。
+     */
+    void setNSTART(uint16_t count) noexcept;
+
+    /**
+     * @brief 获取会话所属的上下文
+     *
+     * @return Context上下文对象的指针
+     *
+     * @exception TargetNotFoundException 会话对象对应的上下文对象不存在时抛出该异常
+     */
+    const Context* getContext() const;
+
+    bool operator==(const SessionView& other) const noexcept { return m_session == other.m_session; }
+    bool operator!=(const SessionView& other) const noexcept { return m_session != other.m_session; }
+
+protected:
+    const coap_session_t* getSession() const noexcept { return m_session; }
+
+private:
+    friend class ContextServer;
+    // 只读视图，snapshot在视图的生命周期内必须有效
+    SessionView(coap_session_t* raw_session, const SessionSnapshot* snapshot) noexcept 
+        : m_session(raw_session), m_snapshot(snapshot) {}
+
+protected:
+    coap_session_t* m_session = nullptr;
+
+private:
+    const SessionSnapshot* m_snapshot = nullptr;
+};
+
+} // namespace CoapPlusPlus
\ No newline at end of file
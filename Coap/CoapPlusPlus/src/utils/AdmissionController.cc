@@ -0,0 +1,98 @@
+#include "AdmissionController.h"
+
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+
+namespace CoapPlusPlus {
+
+// 每次admit()清理时检查的哈希槽数量，负载因子不超过1时平均每个槽不到一个桶
+static constexpr size_t SWEEP_BATCH_SLOTS = 8;
+
+AdmissionController::AdmissionController(double ratePerSecond, uint32_t burst)
+{
+    if(!(ratePerSecond > 0) || burst == 0)
+        throw std::invalid_argument("ratePerSecond must be greater than 0 and burst must not be 0");
+    m_intervalUs = std::max<uint64_t>(1, static_cast<uint64_t>(std::llround(1'000'000.0 / ratePerSecond)));
+    m_toleranceUs = m_intervalUs * (burst - 1);
+    m_burst = burst;
+}
+
+size_t AdmissionController::KeyHash::operator()(const Key& key) const noexcept
+{
+    // FNV-1a
+    uint64_t hash = 14695981039346656037ull;
+    auto mix = [&hash](uint64_t value, int bytes) {
+        for(int i = 0; i < bytes; i++) {
+            hash ^= (value >> (i * 8)) & 0xFF;
+            hash *= 1099511628211ull;
+        }
+    };
+    for(auto byte : key.ip)
+        mix(byte, 1);
+    mix(key.port, 2);
+    mix(key.family, 2);
+    mix(reinterpret_cast<uintptr_t>(key.resource), sizeof(uintptr_t));
+    return static_cast<size_t>(hash);
+}
+
+bool AdmissionController::admit(const Key& key, uint64_t now, uint32_t& retryAfterSeconds) noexcept
+try {
+    auto nowUs = now * 1000;
+    if(m_buckets.empty() == false)
+        sweep(nowUs);
+    auto [iter, inserted] = m_buckets.try_emplace(key, nowUs);
+    if(inserted)
+        m_tracked.store(m_buckets.size(), std::memory_order_relaxed);
+    auto& tat = iter->second;
+    auto earliest = tat > m_toleranceUs ? tat - m_toleranceUs : 0;
+    if(earliest <= nowUs) {
+        tat = std::max(tat, nowUs) + m_intervalUs;
+        m_admitted.fetch_add(1, std::memory_order_relaxed);
+        return true;
+    }
+    auto waitUs = earliest - nowUs;
+    retryAfterSeconds = static_cast<uint32_t>(std::max<uint64_t>(1, (waitUs + 999'999) / 1'000'000));
+    m_rejected.fetch_add(1, std::memory_order_relaxed);
+    return false;
+}catch(std::exception&) {
+    // 无法分配新的桶时放行，限流不应该成为拒绝服务的原因
+    m_admitted.fetch_add(1, std::memory_order_relaxed);
+    return true;
+}
+
+AdmissionController::Stats AdmissionController::getStats() const noexcept
+{
+    Stats stats;
+    stats.admitted = m_admitted.load(std::memory_order_relaxed);
+    stats.rejected = m_rejected.load(std::memory_order_relaxed);
+    stats.tracked = m_tracked.load(std::memory_order_relaxed);
+    return stats;
+}
+
+void AdmissionController::sweep(uint64_t nowUs) noexcept
+{
+    // 扩容后槽的编号改变，游标只是位置，下一轮仍会覆盖所有的槽
+    auto slotCount = m_buckets.bucket_count();
+    auto size = m_buckets.size();
+    for(size_t i = 0; i < SWEEP_BATCH_SLOTS; i++) {
+        if(m_sweepCursor >= slotCount)
+            m_sweepCursor = 0;
+        auto slot = m_sweepCursor++;
+        // 按键删除不会使其他槽失效，删除后从槽头重新检查
+        for(auto it = m_buckets.begin(slot); it != m_buckets.end(slot);) {
+            if(it->second <= nowUs) {
+                auto key = it->first;
+                m_buckets.erase(key);
+                it = m_buckets.begin(slot);
+            }
+            else {
+                ++it;
+            }
+        }
+    }
+    if(m_buckets.size() != size)
+        m_tracked.store(m_buckets.size(), std::memory_order_relaxed);
+}
+
+} // namespace CoapPlusPlus
@@ -0,0 +1,109 @@
+/**
+ * @file AdmissionController.h
+ * @author Hulu
+ * @brief 按对等体限流的准入控制器定义
+ * @version 0.1
+ * @date 2023-09-05
+ *
+ * @copyright Copyright (c) 2023
+ *
+ */
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <unordered_map>
+
+namespace CoapPlusPlus {
+
+/**
+ * @brief 令牌桶准入控制器，每个对等体(可选地再按资源区分)有一个独立的令牌桶
+ * @details 桶以固定速率补充令牌，最多积累burst个；每个请求消耗一个令牌，没有令牌时拒绝并给出建议的重试秒数。
+ *          令牌桶以GCRA的方式实现：每个桶只保存一个理论到达时间(微秒)，全部是整数运算，没有浮点误差的累积。
+ *          补满的桶与新建的桶没有区别，可以移除。每次admit()只检查固定数量的哈希槽，游标在槽之间轮转，
+ *          请求路径上的清理开销与跟踪的桶数量无关；每个请求最多新建一个桶而检查多个槽，
+ *          因此跟踪的桶数量只与近期活跃的对等体数量有关。
+ *          admit()不是线程安全的，由使用者保证只在一个线程中调用；统计信息可以在任意线程中读取。
+ */
+class AdmissionController
+{
+    AdmissionController& operator=(const AdmissionController&) = delete;
+    AdmissionController& operator=(AdmissionController&&) = delete;
+    AdmissionController(const AdmissionController&) = delete;
+    AdmissionController(AdmissionController&&) = delete;
+public:
+    /**
+     * @brief 令牌桶的键，由对等体的地址、端口和可选的资源标识组成
+     *
+     */
+    struct Key {
+        std::array<uint8_t, 16> ip {};  // IPv4地址只使用前4个字节
+        uint16_t port = 0;
+        uint16_t family = 0;
+        const void* resource = nullptr; // 不按资源区分时为nullptr
+
+        bool operator==(const Key& other) const noexcept {
+            return ip == other.ip && port == other.port && family == other.family && resource == other.resource;
+        }
+    };
+
+    /**
+     * @brief 准入统计信息
+     *
+     */
+    struct Stats {
+        uint64_t admitted = 0;  // 累计通过的请求数量
+        uint64_t rejected = 0;  // 累计拒绝的请求数量
+        uint64_t tracked = 0;   // 当前跟踪的令牌桶数量
+    };
+
+    /**
+     * @brief 构造一个准入控制器
+     *
+     * @param ratePerSecond 每秒补充的令牌数量
+     * @param burst 桶的容量，即允许的突发请求数量
+     *
+     * @exception std::invalid_argument ratePerSecond小于等于0或者burst为0
+     */
+    AdmissionController(double ratePerSecond, uint32_t burst);
+    ~AdmissionController() noexcept = default;
+
+    /**
+     * @brief 判断一个请求是否可以通过
+     *
+     * @param key 请求对应的令牌桶
+     * @param now 当前时间(毫秒)
+     * @param retryAfterSeconds 拒绝时写入建议客户端等待的秒数，至少为1
+     * @return 是否通过
+     */
+    bool admit(const Key& key, uint64_t now, uint32_t& retryAfterSeconds) noexcept;
+
+    /**
+     * @brief 获取统计信息，可以在任意线程中调用
+     *
+     */
+    Stats getStats() const noexcept;
+
+    double getRate() const noexcept { return 1'000'000.0 / m_intervalUs; }
+    uint32_t getBurst() const noexcept { return m_burst; }
+
+private:
+    struct KeyHash {
+        size_t operator()(const Key& key) const noexcept;
+    };
+
+    void sweep(uint64_t nowUs) noexcept;
+
+private:
+    uint64_t m_intervalUs;      // 补充一个令牌所需的微秒数
+    uint64_t m_toleranceUs;     // 允许理论到达时间超前的微秒数，即(burst - 1)个令牌
+    uint32_t m_burst;
+    size_t m_sweepCursor = 0;   // 下一次清理开始的哈希槽
+    std::unordered_map<Key, uint64_t, KeyHash> m_buckets;   // 键 -> 理论到达时间(微秒)，不晚于当前时间表示桶是满的
+    std::atomic<uint64_t> m_admitted = 0;
+    std::atomic<uint64_t> m_rejected = 0;
+    std::atomic<uint64_t> m_tracked = 0;
+};
+
+} // namespace CoapPlusPlus
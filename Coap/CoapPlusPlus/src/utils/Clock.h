@@ -0,0 +1,85 @@
+/**
+ * @file Clock.h
+ * @author Hulu
+ * @brief Context使用的时钟定义
+ * @version 0.1
+ * @date 2023-08-25
+ *
+ * @copyright Copyright (c) 2023
+ *
+ */
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+
+namespace CoapPlusPlus {
+
+/**
+ * @brief 时钟接口，提供单调递增的毫秒时间，Context的定时器等功能通过它获取当前时间
+ * @see Context::setClock()
+ */
+class Clock
+{
+public:
+    virtual ~Clock() noexcept = default;
+
+    /**
+     * @brief 获取当前时间
+     *
+     * @return 单调递增的毫秒数，起点没有意义，只能用于计算时间差
+     * @note 该函数可能在任意线程中被调用
+     */
+    virtual uint64_t nowMs() const noexcept = 0;
+};
+
+/**
+ * @brief 基于std::chrono::steady_clock的时钟，Context默认使用该时钟
+ *
+ */
+class SteadyClock : public Clock
+{
+public:
+    uint64_t nowMs() const noexcept override {
+        using namespace std::chrono;
+        return duration_cast<milliseconds>(steady_clock::now().time_since_epoch()).count();
+    }
+};
+
+/**
+ * @brief 手动推进的时钟，用于测试和基准测试
+ * @details 时间只在调用advance()时前进，几个小时的定时场景可以在几毫秒内确定地跑完。
+ *
+ * @code {.cpp}
+ * auto clock = new ManualClock;
+ * context.setClock(std::unique_ptr<Clock>(clock));
+ * context.addTimer(60 * 1000, callback, 60 * 1000);
+ * for(int i = 0; i < 60; i++) {
+ *     clock->advance(60 * 1000);
+ *     context.ioProcess(-1);    // 执行到期的定时器
+ * }
+ * @endcode
+ *
+ * @note 该时钟只影响CoapPlusPlus自身的定时功能，libcoap内部的重传、会话超时等仍然使用系统时间
+ */
+class ManualClock : public Clock
+{
+public:
+    explicit ManualClock(uint64_t startMs = 0) noexcept : m_now(startMs) { }
+
+    uint64_t nowMs() const noexcept override { return m_now; }
+
+    /**
+     * @brief 把时间向前推进
+     *
+     * @param ms 推进的毫秒数
+     * @note I/O线程正在运行时，推进后需要调用Context::wakeup()让它重新计算等待时间
+     */
+    void advance(uint64_t ms) noexcept { m_now += ms; }
+
+private:
+    std::atomic<uint64_t> m_now;
+};
+
+}; // namespace CoapPlusPlus
@@ -0,0 +1,138 @@
+#include "HealthProbe.h"
+#include <coap3/coap.h>
+
+#include <algorithm>
+#include <stdexcept>
+
+namespace CoapPlusPlus {
+
+HealthProbe::HealthProbe(const Options& options, std::function<void(PeerId, bool)> observer)
+    : m_options(options), m_observer(std::move(observer))
+{
+    if(options.timeoutMs == 0 || options.maxLosses == 0 || !(options.alpha > 0 && options.alpha <= 1))
+        throw std::invalid_argument("timeoutMs and maxLosses must not be 0 and alpha must be in (0, 1]");
+}
+
+bool HealthProbe::isProbing(PeerId peer) const noexcept
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    auto it = m_peers.find(peer);
+    return it != m_peers.end() && it->second.probing;
+}
+
+void HealthProbe::onSent(PeerId peer, int mid, uint64_t now) noexcept
+try {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    auto& state = m_peers[peer];
+    state.probing = true;
+    state.mid = mid;
+    state.sentAt = now;
+    state.health.sent++;
+}catch(std::exception& e) {
+    coap_log_warn("HealthProbe: %s\n", e.what());
+}
+
+bool HealthProbe::onPong(PeerId peer, int mid, uint64_t now) noexcept
+{
+    bool changed;
+    bool healthy;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        auto it = m_peers.find(peer);
+        if(it == m_peers.end() || it->second.probing == false || it->second.mid != mid)
+            return false;
+        auto& state = it->second;
+        auto& health = state.health;
+        state.probing = false;
+        auto rtt = static_cast<uint32_t>(std::min<uint64_t>(now > state.sentAt ? now - state.sentAt : 0, UINT32_MAX));
+        health.lastRttMs = rtt;
+        health.rttMs = health.received == 0 ? rtt : health.rttMs + m_options.alpha * (rtt - health.rttMs);
+        health.received++;
+        health.consecutiveLosses = 0;
+        changed = evaluate(health);
+        healthy = health.healthy;
+    }
+    if(changed)
+        notify(peer, healthy);
+    return true;
+}
+
+void HealthProbe::expire(uint64_t now) noexcept
+try {
+    std::vector<std::pair<PeerId, bool>> changes;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        for(auto& [peer, state] : m_peers) {
+            if(state.probing == false || now - state.sentAt < m_options.timeoutMs)
+                continue;
+            state.probing = false;
+            state.health.lost++;
+            state.health.consecutiveLosses++;
+            if(evaluate(state.health))
+                changes.emplace_back(peer, state.health.healthy);
+        }
+    }
+    for(auto& [peer, healthy] : changes)
+        notify(peer, healthy);
+}catch(std::exception& e) {
+    coap_log_warn("HealthProbe: %s\n", e.what());
+}
+
+void HealthProbe::removePeer(PeerId peer) noexcept
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_peers.erase(peer);
+}
+
+bool HealthProbe::getHealth(PeerId peer, Health& health) const noexcept
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    auto it = m_peers.find(peer);
+    if(it == m_peers.end())
+        return false;
+    health = it->second.health;
+    return true;
+}
+
+std::vector<std::pair<HealthProbe::PeerId, HealthProbe::Health>> HealthProbe::getAllHealth() const
+{
+    std::vector<std::pair<PeerId, Health>> result;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        result.reserve(m_peers.size());
+        for(auto& [peer, state] : m_peers)
+            result.emplace_back(peer, state.health);
+    }
+    // 还没有往返时间样本的对等体排在有样本的健康对等体之后
+    std::sort(result.begin(), result.end(), [](const auto& a, const auto& b) {
+        auto rank = [](const Health& health) { return health.healthy == false ? 2 : health.received == 0 ? 1 : 0; };
+        auto rankA = rank(a.second), rankB = rank(b.second);
+        if(rankA != rankB)
+            return rankA < rankB;
+        return a.second.rttMs < b.second.rttMs;
+    });
+    return result;
+}
+
+bool HealthProbe::evaluate(Health& health) const noexcept
+{
+    bool healthy = health.consecutiveLosses < m_options.maxLosses;
+    if(healthy && m_options.maxRttMs > 0 && health.received > 0)
+        healthy = health.rttMs <= m_options.maxRttMs;
+    if(healthy == health.healthy)
+        return false;
+    health.healthy = healthy;
+    return true;
+}
+
+void HealthProbe::notify(PeerId peer, bool healthy) const noexcept
+try {
+    if(m_observer)
+        m_observer(peer, healthy);
+}catch(std::exception& e) {
+    coap_log_warn("HealthProbe observer threw an exception: %s\n", e.what());
+}catch(...) {
+    coap_log_warn("HealthProbe observer threw an unknown exception.\n");
+}
+
+} // namespace CoapPlusPlus
@@ -0,0 +1,149 @@
+/**
+ * @file HealthProbe.h
+ * @author Hulu
+ * @brief 基于CoAP ping的对等体健康探测定义
+ * @version 0.1
+ * @date 2023-09-06
+ *
+ * @copyright Copyright (c) 2023
+ *
+ */
+#pragma once
+
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace CoapPlusPlus {
+
+/**
+ * @brief 记录每个对等体的ping往返时间并判断其是否健康
+ * @details 每个对等体同一时间最多有一个未应答的ping，所有对等体的ping互不等待。
+ *          收到pong时用指数加权移动平均(EWMA)平滑往返时间，并清零连续丢失次数；
+ *          超过timeoutMs仍未收到pong视为丢失，连续丢失maxLosses次，或者平滑后的往返时间超过maxRttMs时标记为不健康，
+ *          之后收到一个满足条件的pong即恢复健康。
+ *          HealthProbe只负责记录和判断，不发送报文，时间由调用者传入，因此可以脱离网络单独使用。
+ *          onSent()、onPong()、expire()应在同一个线程中调用，查询可以在任意线程中进行。
+ */
+class HealthProbe
+{
+    HealthProbe& operator=(const HealthProbe&) = delete;
+    HealthProbe& operator=(HealthProbe&&) = delete;
+    HealthProbe(const HealthProbe&) = delete;
+    HealthProbe(HealthProbe&&) = delete;
+public:
+    using PeerId = uint64_t;
+
+    /**
+     * @brief 探测配置
+     *
+     */
+    struct Options {
+        uint32_t timeoutMs = 2000;  // 超过该时间未收到pong视为丢失
+        double alpha = 0.125;       // 新样本在平滑往返时间中的权重，取值(0, 1]，默认值同RFC6298
+        uint32_t maxLosses = 3;     // 连续丢失该次数后标记为不健康
+        uint32_t maxRttMs = 0;      // 平滑往返时间超过该值时标记为不健康，0表示不检查
+    };
+
+    /**
+     * @brief 一个对等体的健康状况
+     *
+     */
+    struct Health {
+        bool healthy = true;
+        double rttMs = 0;               // 平滑后的往返时间(毫秒)，还没有收到pong时为0
+        uint32_t lastRttMs = 0;         // 最近一次的往返时间(毫秒)
+        uint32_t consecutiveLosses = 0; // 连续丢失的ping数量
+        uint64_t sent = 0;              // 累计发送的ping数量
+        uint64_t received = 0;          // 累计收到的pong数量
+        uint64_t lost = 0;              // 累计丢失的ping数量
+    };
+
+    /**
+     * @brief 构造一个健康探测器
+     *
+     * @param options 探测配置
+     * @param observer 对等体健康状态变化时调用，参数为对等体和是否健康，在调用onPong()、expire()的线程中被调用
+     *
+     * @exception std::invalid_argument timeoutMs或maxLosses为0，或者alpha不在(0, 1]之间
+     */
+    explicit HealthProbe(const Options& options, std::function<void(PeerId, bool)> observer = nullptr);
+    ~HealthProbe() noexcept = default;
+
+    /**
+     * @brief 对等体是否有未应答的ping
+     *
+     */
+    bool isProbing(PeerId peer) const noexcept;
+
+    /**
+     * @brief 记录向对等体发送了一个ping，对等体不存在时开始跟踪它
+     *
+     * @param peer 对等体
+     * @param mid ping的消息id，用于匹配pong
+     * @param now 当前时间(毫秒)
+     */
+    void onSent(PeerId peer, int mid, uint64_t now) noexcept;
+
+    /**
+     * @brief 记录收到了对等体的pong
+     *
+     * @param peer 对等体
+     * @param mid pong的消息id
+     * @param now 当前时间(毫秒)
+     * @return 是否与未应答的ping匹配，超时之后才到达的pong不匹配
+     */
+    bool onPong(PeerId peer, int mid, uint64_t now) noexcept;
+
+    /**
+     * @brief 把超时未应答的ping记为丢失
+     *
+     * @param now 当前时间(毫秒)
+     */
+    void expire(uint64_t now) noexcept;
+
+    /**
+     * @brief 停止跟踪一个对等体
+     *
+     */
+    void removePeer(PeerId peer) noexcept;
+
+    /**
+     * @brief 获取一个对等体的健康状况
+     *
+     * @param peer 对等体
+     * @param health 写入健康状况
+     * @return 是否正在跟踪该对等体
+     */
+    bool getHealth(PeerId peer, Health& health) const noexcept;
+
+    /**
+     * @brief 获取所有对等体的健康状况，按平滑往返时间从小到大排列，不健康的对等体排在最后
+     *
+     */
+    std::vector<std::pair<PeerId, Health>> getAllHealth() const;
+
+    const Options& getOptions() const noexcept { return m_options; }
+
+private:
+    struct Peer {
+        Health health;
+        bool probing = false;
+        int mid = 0;
+        uint64_t sentAt = 0;
+    };
+
+    bool evaluate(Health& health) const noexcept;
+    void notify(PeerId peer, bool healthy) const noexcept;
+
+private:
+    Options m_options;
+    std::function<void(PeerId, bool)> m_observer;
+    mutable std::mutex m_mutex;
+    std::unordered_map<PeerId, Peer> m_peers;   // 由m_mutex保护
+};
+
+} // namespace CoapPlusPlus
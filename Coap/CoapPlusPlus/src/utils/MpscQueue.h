@@ -0,0 +1,91 @@
+/**
+ * @file MpscQueue.h
+ * @author Hulu
+ * @brief 无锁的多生产者单消费者队列
+ * @version 0.1
+ * @date 2023-08-21
+ * 
+ * @copyright Copyright (c) 2023
+ * 
+ */
+#pragma once
+
+#include <atomic>
+#include <optional>
+#include <utility>
+
+namespace CoapPlusPlus {
+
+/**
+ * @brief 无锁的多生产者单消费者队列(Vyukov MPSC)
+ * @details 任意线程都可以调用push()，生产者之间只竞争一次原子交换；
+ *          pop()只能在唯一的消费者线程中调用。
+ * 
+ * @tparam T 元素类型，需要可移动构造
+ */
+template<typename T>
+class MpscQueue
+{
+    MpscQueue& operator=(const MpscQueue&) = delete;
+    MpscQueue& operator=(MpscQueue&&) = delete;
+    MpscQueue(const MpscQueue&) = delete;
+    MpscQueue(MpscQueue&&) = delete;
+
+    struct Node {
+        std::atomic<Node*> next = nullptr;
+        std::optional<T> value;
+    };
+public:
+    MpscQueue() : m_head(new Node), m_tail(m_head.load()) { }
+    ~MpscQueue() noexcept {
+        while(pop().has_value());
+        delete m_tail;
+    }
+
+    /**
+     * @brief 向队列尾部添加一个元素，可以在任意线程中调用
+     * 
+     * @param value 元素
+     */
+    void push(T value) {
+        auto node = new Node;
+        node->value.emplace(std::move(value));
+        auto prev = m_head.exchange(node, std::memory_order_acq_rel);
+        prev->next.store(node, std::memory_order_release);
+    }
+
+    /**
+     * @brief 从队列头部取出一个元素，只能在消费者线程中调用
+     * 
+     * @return 队列为空时返回std::nullopt
+     * 
+     * @note 生产者交换了m_head但还没有链接next时，该元素暂时不可见，会在之后的pop()中取出
+     */
+    std::optional<T> pop() {
+        auto tail = m_tail;
+        auto next = tail->next.load(std::memory_order_acquire);
+        if(next == nullptr)
+            return std::nullopt;
+        std::optional<T> value = std::move(next->value);
+        next->value.reset();
+        m_tail = next;
+        delete tail;
+        return value;
+    }
+
+    /**
+     * @brief 队列是否为空，只能在消费者线程中调用
+     * 
+     * @return true 队列为空
+     * @return false 队列不为空
+     */
+    bool empty() const noexcept {
+        return m_tail->next.load(std::memory_order_acquire) == nullptr;
+    }
+
+private:
+    std::atomic<Node*> m_head;  // 生产者添加元素的位置
+    Node* m_tail;               // 消费者取出元素的位置，指向已经取出的哨兵节点
+};
+
+}; // namespace CoapPlusPlus
@@ -0,0 +1,70 @@
+#include "ThreadPool.h"
+#include <coap3/coap.h>
+#include <algorithm>
+
+namespace CoapPlusPlus {
+
+ThreadPool::ThreadPool(size_t threadCount)
+{
+    if(threadCount == 0)
+        threadCount = std::max(1u, std::thread::hardware_concurrency());
+    m_threads.reserve(threadCount);
+    for(size_t i = 0; i < threadCount; i++)
+        m_threads.emplace_back(&ThreadPool::threadFunc, this);
+}
+
+ThreadPool::~ThreadPool() noexcept
+{
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_stopping = true;
+    }
+    m_condition.notify_all();
+    for(auto& thread : m_threads) {
+        if(thread.joinable())
+            thread.join();
+    }
+    m_threads.clear();
+}
+
+bool ThreadPool::submit(std::function<void()> task) noexcept
+try {
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if(m_stopping)
+            return false;
+        m_tasks.push_back(std::move(task));
+    }
+    m_condition.notify_one();
+    return true;
+}catch(std::exception& e) {
+    coap_log_err("ThreadPool::submit() failed: %s\n", e.what());
+    return false;
+}
+
+void ThreadPool::threadFunc() noexcept
+{
+    while(true) {
+        std::function<void()> task;
+        {
+            std::unique_lock<std::mutex> lock(m_mutex);
+            m_condition.wait(lock, [this] { return m_stopping || m_tasks.empty() == false; });
+            // 停止时也要把已经提交的任务执行完
+            if(m_tasks.empty())
+                return;
+            task = std::move(m_tasks.front());
+            m_tasks.pop_front();
+        }
+        try {
+            task();
+        }
+        catch(const std::exception& e) {
+            coap_log_warn("ThreadPool task threw an exception: %s\n", e.what());
+        }
+        catch(...) {
+            coap_log_warn("ThreadPool task threw an unknown exception.\n");
+        }
+    }
+}
+
+}; // namespace CoapPlusPlus
@@ -0,0 +1,71 @@
+/**
+ * @file ThreadPool.h
+ * @author Hulu
+ * @brief 固定大小的线程池定义
+ * @version 0.1
+ * @date 2023-08-28
+ *
+ * @copyright Copyright (c) 2023
+ *
+ */
+#pragma once
+
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace CoapPlusPlus {
+
+/**
+ * @brief 固定大小的线程池，任务按提交顺序被空闲的线程取出执行
+ *
+ */
+class ThreadPool
+{
+    ThreadPool& operator=(const ThreadPool&) = delete;
+    ThreadPool& operator=(ThreadPool&&) = delete;
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool(ThreadPool&&) = delete;
+public:
+    /**
+     * @brief 构造线程池并立刻启动所有线程
+     *
+     * @param threadCount 线程数量，为0时使用std::thread::hardware_concurrency()
+     */
+    explicit ThreadPool(size_t threadCount = 0);
+
+    /**
+     * @brief 等待已经提交的任务全部执行完毕后销毁线程池
+     *
+     */
+    ~ThreadPool() noexcept;
+
+    /**
+     * @brief 提交一个任务，可以在任意线程中调用
+     *
+     * @param task 任务，抛出的异常会被记录后忽略
+     * @return 是否提交成功，线程池正在销毁时返回false
+     */
+    bool submit(std::function<void()> task) noexcept;
+
+    /**
+     * @brief 获取线程数量
+     *
+     */
+    size_t getThreadCount() const noexcept { return m_threads.size(); }
+
+private:
+    void threadFunc() noexcept;
+
+private:
+    std::vector<std::thread> m_threads;
+    std::mutex m_mutex;
+    std::condition_variable m_condition;
+    std::deque<std::function<void()>> m_tasks;
+    bool m_stopping = false;
+};
+
+}; // namespace CoapPlusPlus
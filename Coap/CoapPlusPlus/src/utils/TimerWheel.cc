@@ -0,0 +1,208 @@
+#include "TimerWheel.h"
+
+#include <algorithm>
+#include <bit>
+
+namespace CoapPlusPlus {
+
+// 节点所在位置，非负数表示所在的层
+static constexpr int8_t LOCATION_OVERFLOW = -1;
+static constexpr int8_t LOCATION_DUE = -2;
+static constexpr int8_t LOCATION_DETACHED = -3;
+
+struct TimerWheel::Node {
+    TimerId id = 0;
+    uint64_t expire = 0;
+    uint64_t period = 0;
+    std::function<void()> callback;
+    Node* prev = nullptr;
+    Node* next = nullptr;
+    int8_t location = LOCATION_DETACHED;
+    uint8_t slot = 0;
+};
+
+TimerWheel::~TimerWheel() noexcept
+{
+    for(auto& [id, node] : m_nodes)
+        delete node;
+    m_nodes.clear();
+}
+
+TimerWheel::TimerId TimerWheel::schedule(uint64_t expire, uint64_t period, std::function<void()> callback)
+{
+    auto node = new Node;
+    node->id = m_nextId++;
+    node->expire = expire;
+    node->period = period;
+    node->callback = std::move(callback);
+    m_nodes.emplace(node->id, node);
+    place(node);
+    return node->id;
+}
+
+bool TimerWheel::cancel(TimerId id) noexcept
+{
+    auto it = m_nodes.find(id);
+    if(it == m_nodes.end())
+        return false;
+    auto node = it->second;
+    // 正在执行回调的周期定时器不在任何链表中，删除后rearm()会找不到它
+    if(node->location != LOCATION_DETACHED)
+        unlink(node);
+    m_nodes.erase(it);
+    delete node;
+    return true;
+}
+
+bool TimerWheel::popExpired(uint64_t now, Expired& expired)
+{
+    now = std::max(now, m_current);
+    m_now = now;
+    while(m_due.head == nullptr) {
+        auto next = nextExpire();
+        if(next.has_value() == false || next.value() > now) {
+            moveTo(now);
+            return false;
+        }
+        moveTo(next.value());
+    }
+    auto node = m_due.head;
+    unlink(node);
+    expired.id = node->id;
+    expired.period = node->period;
+    expired.callback = std::move(node->callback);
+    if(node->period == 0) {
+        m_nodes.erase(node->id);
+        delete node;
+    }
+    return true;
+}
+
+void TimerWheel::rearm(Expired&& expired)
+{
+    auto it = m_nodes.find(expired.id);
+    if(it == m_nodes.end() || it->second->location != LOCATION_DETACHED)
+        return;
+    auto node = it->second;
+    node->callback = std::move(expired.callback);
+    node->expire += node->period;
+    if(node->expire <= m_now)
+        node->expire = m_now + node->period;
+    place(node);
+}
+
+std::optional<uint64_t> TimerWheel::nextExpire() const noexcept
+{
+    if(m_due.head != nullptr)
+        return m_current;
+    // 同一层中所有定时器都位于当前槽之后，且低层的定时器总是早于高层，所以第一个非空槽就是最早的
+    for(int level = 0; level < LEVELS; level++) {
+        if(m_bitmap[level] == 0)
+            continue;
+        auto slot = std::countr_zero(m_bitmap[level]);
+        if(level == 0)
+            return (m_current & ~static_cast<uint64_t>(SLOTS - 1)) | static_cast<uint64_t>(slot);
+        auto expire = UINT64_MAX;
+        for(auto node = m_slots[level][slot].head; node != nullptr; node = node->next)
+            expire = std::min(expire, node->expire);
+        return expire;
+    }
+    if(m_overflow.head == nullptr)
+        return std::nullopt;
+    auto expire = UINT64_MAX;
+    for(auto node = m_overflow.head; node != nullptr; node = node->next)
+        expire = std::min(expire, node->expire);
+    return expire;
+}
+
+void TimerWheel::place(Node* node) noexcept
+{
+    if(node->expire <= m_current) {
+        pushFront(m_due, node);
+        node->location = LOCATION_DUE;
+        return;
+    }
+    // 与当前时间处于同一个上层块的最低一层
+    for(int level = 0; level < LEVELS; level++) {
+        auto shift = (level + 1) * SLOT_BITS;
+        if((node->expire >> shift) == (m_current >> shift)) {
+            auto slot = (node->expire >> (level * SLOT_BITS)) & (SLOTS - 1);
+            pushFront(m_slots[level][slot], node);
+            m_bitmap[level] |= (uint64_t(1) << slot);
+            node->location = static_cast<int8_t>(level);
+            node->slot = static_cast<uint8_t>(slot);
+            return;
+        }
+    }
+    pushFront(m_overflow, node);
+    node->location = LOCATION_OVERFLOW;
+}
+
+void TimerWheel::unlink(Node* node) noexcept
+{
+    auto& list = listOf(node);
+    if(node->prev)
+        node->prev->next = node->next;
+    else
+        list.head = node->next;
+    if(node->next)
+        node->next->prev = node->prev;
+    if(node->location >= 0 && list.head == nullptr)
+        m_bitmap[node->location] &= ~(uint64_t(1) << node->slot);
+    node->prev = nullptr;
+    node->next = nullptr;
+    node->location = LOCATION_DETACHED;
+}
+
+void TimerWheel::pushFront(List& list, Node* node) noexcept
+{
+    node->prev = nullptr;
+    node->next = list.head;
+    if(list.head)
+        list.head->prev = node;
+    list.head = node;
+}
+
+TimerWheel::List& TimerWheel::listOf(const Node* node) noexcept
+{
+    if(node->location == LOCATION_OVERFLOW)
+        return m_overflow;
+    if(node->location == LOCATION_DUE)
+        return m_due;
+    return m_slots[node->location][node->slot];
+}
+
+void TimerWheel::moveTo(uint64_t time) noexcept
+{
+    if(time <= m_current)
+        return;
+    auto old = m_current;
+    m_current = time;
+    // 进入新的块时，把该块对应的槽重新分配到低层，先高层后低层
+    if((time >> (LEVELS * SLOT_BITS)) != (old >> (LEVELS * SLOT_BITS)))
+        cascade(m_overflow);
+    for(int level = LEVELS - 1; level > 0; level--) {
+        auto shift = level * SLOT_BITS;
+        if((time >> shift) == (old >> shift))
+            continue;
+        auto slot = (time >> shift) & (SLOTS - 1);
+        m_bitmap[level] &= ~(uint64_t(1) << slot);
+        cascade(m_slots[level][slot]);
+    }
+    auto slot = time & (SLOTS - 1);
+    m_bitmap[0] &= ~(uint64_t(1) << slot);
+    cascade(m_slots[0][slot]);
+}
+
+void TimerWheel::cascade(List& list) noexcept
+{
+    auto node = list.head;
+    list.head = nullptr;
+    while(node) {
+        auto next = node->next;
+        place(node);
+        node = next;
+    }
+}
+
+}; // namespace CoapPlusPlus
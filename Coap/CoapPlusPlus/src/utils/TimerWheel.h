@@ -0,0 +1,132 @@
+/**
+ * @file TimerWheel.h
+ * @author Hulu
+ * @brief 分层时间轮定义
+ * @version 0.1
+ * @date 2023-08-24
+ *
+ * @copyright Copyright (c) 2023
+ *
+ */
+#pragma once
+
+#include <cstdint>
+#include <functional>
+#include <optional>
+#include <unordered_map>
+
+namespace CoapPlusPlus {
+
+/**
+ * @brief 分层时间轮，时间单位为毫秒
+ * @details 共4层，每层64个槽，第0层的精度为1毫秒，可以覆盖约4.6小时，超出范围的定时器放在溢出链表中。
+ *          添加、取消定时器的时间复杂度为O(1)，查询最近的到期时间通过每层的占用位图完成。
+ *          该类不是线程安全的，由使用者负责加锁。
+ */
+class TimerWheel
+{
+    TimerWheel& operator=(const TimerWheel&) = delete;
+    TimerWheel& operator=(TimerWheel&&) = delete;
+    TimerWheel(const TimerWheel&) = delete;
+    TimerWheel(TimerWheel&&) = delete;
+
+    struct Node;
+    struct List { Node* head = nullptr; };
+public:
+    using TimerId = uint64_t;
+
+    /**
+     * @brief 已经到期的定时器，回调函数的所有权暂时转移给调用者
+     *
+     */
+    struct Expired {
+        TimerId id = 0;
+        uint64_t period = 0;
+        std::function<void()> callback;
+    };
+
+    /**
+     * @brief 构造一个时间轮
+     *
+     * @param now 当前时间(毫秒)
+     */
+    explicit TimerWheel(uint64_t now) noexcept : m_current(now), m_now(now) { }
+    ~TimerWheel() noexcept;
+
+    /**
+     * @brief 添加一个定时器
+     *
+     * @param expire 到期时间(毫秒)，早于当前时间的定时器会在下一次popExpired()时立刻到期
+     * @param period 周期(毫秒)，0表示只触发一次
+     * @param callback 回调函数
+     * @return 定时器的id，从1开始递增
+     */
+    TimerId schedule(uint64_t expire, uint64_t period, std::function<void()> callback);
+
+    /**
+     * @brief 取消一个定时器
+     *
+     * @param id 定时器的id
+     * @return 是否取消成功
+     *      @retval false 定时器不存在或者一次性定时器已经到期
+     */
+    bool cancel(TimerId id) noexcept;
+
+    /**
+     * @brief 把时间推进到now，并取出一个已经到期的定时器
+     *
+     * @param now 当前时间(毫秒)，早于内部时间时按内部时间处理
+     * @param expired 取出的定时器
+     * @return 是否取出了定时器
+     *
+     * @note 周期定时器在回调执行完之后需要通过rearm()重新加入时间轮，期间调用cancel()可以阻止其重新加入
+     */
+    bool popExpired(uint64_t now, Expired& expired);
+
+    /**
+     * @brief 把popExpired()取出的周期定时器按照下一个周期重新加入时间轮，如果期间被取消则丢弃
+     * @details 如果错过了一个或多个周期，则从最近一次popExpired()传入的时间开始计算下一个周期，不会集中补发
+     *
+     * @param expired popExpired()取出的定时器
+     */
+    void rearm(Expired&& expired);
+
+    /**
+     * @brief 获取最近的到期时间
+     *
+     * @return 最近的到期时间(毫秒)，没有定时器时返回std::nullopt
+     */
+    std::optional<uint64_t> nextExpire() const noexcept;
+
+    /**
+     * @brief 获取定时器的数量，包括正在执行回调的周期定时器
+     *
+     */
+    size_t size() const noexcept { return m_nodes.size(); }
+
+    bool empty() const noexcept { return m_nodes.empty(); }
+
+private:
+    void place(Node* node) noexcept;
+    void unlink(Node* node) noexcept;
+    void pushFront(List& list, Node* node) noexcept;
+    List& listOf(const Node* node) noexcept;
+    void moveTo(uint64_t time) noexcept;
+    void cascade(List& list) noexcept;
+
+private:
+    static constexpr int LEVELS = 4;
+    static constexpr int SLOT_BITS = 6;
+    static constexpr int SLOTS = 1 << SLOT_BITS;
+
+    uint64_t m_current;     ///< 时间轮内部已经推进到的时间
+    uint64_t m_now;         ///< 最近一次popExpired()传入的时间
+    TimerId m_nextId = 1;
+    List m_slots[LEVELS][SLOTS];
+    uint64_t m_bitmap[LEVELS] = {};
+    List m_overflow;
+    List m_due;
+    std::unordered_map<TimerId, Node*> m_nodes;
+};
+
+}; // namespace CoapPlusPlus
@@ -0,0 +1,201 @@
+/**
+ * @file TokenTable.h
+ * @author Hulu
+ * @brief 以token为键的开放寻址哈希表
+ * @version 0.1
+ * @date 2023-09-08
+ *
+ * @copyright Copyright (c) 2023
+ *
+ */
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <vector>
+
+namespace CoapPlusPlus {
+
+/**
+ * @brief 以不超过8个字节的token为键、保存指针的开放寻址哈希表
+ * @details token被打包成一个64位整数和长度，查找时直接由token的字节构造键，不需要复制token，也不分配内存。
+ *          冲突以线性探测解决，删除时把后续的元素向前移动(backward shift)，不留下墓碑，
+ *          因此大量请求反复发送和完成之后，探测长度也不会变长。负载超过3/4时容量翻倍。
+ *          表不持有保存的指针，由使用者负责释放；不是线程安全的。
+ *
+ * @tparam T 保存的指针指向的类型
+ */
+template<typename T>
+class TokenTable
+{
+    TokenTable& operator=(const TokenTable&) = delete;
+    TokenTable(const TokenTable&) = delete;
+public:
+    /**
+     * @brief 打包后的token
+     *
+     */
+    struct Key {
+        uint64_t packed = 0;    // token的字节按大端顺序打包
+        uint8_t length = 0;     // token的长度，区分前导0字节
+
+        bool operator==(const Key& other) const noexcept { return packed == other.packed && length == other.length; }
+    };
+
+    /**
+     * @brief 由token的字节构造键
+     *
+     * @param token token的字节
+     * @param key 写入构造的键
+     * @return 是否构造成功，token超过8个字节时失败
+     */
+    static bool MakeKey(std::span<const uint8_t> token, Key& key) noexcept {
+        if(token.size() > 8)
+            return false;
+        key.packed = 0;
+        for(auto byte : token)
+            key.packed = (key.packed << 8) | byte;
+        key.length = static_cast<uint8_t>(token.size());
+        return true;
+    }
+
+    TokenTable() noexcept = default;
+    ~TokenTable() noexcept = default;
+
+    /**
+     * @brief 查找一个键对应的指针
+     *
+     * @return 未找到时返回nullptr
+     */
+    T* find(const Key& key) const noexcept {
+        if(m_size == 0)
+            return nullptr;
+        for(auto i = Hash(key) & m_mask; m_slots[i].value != nullptr; i = (i + 1) & m_mask) {
+            if(m_slots[i].packed == key.packed && m_slots[i].length == key.length)
+                return m_slots[i].value;
+        }
+        return nullptr;
+    }
+
+    /**
+     * @brief 插入一个键和指针
+     *
+     * @param key 键
+     * @param value 指针，不能为空
+     * @return 是否插入成功，键已经存在或者value为空时失败
+     *
+     * @exception std::bad_alloc 扩容时无法分配内存，此时表不会改变
+     */
+    bool insert(const Key& key, T* value) {
+        if(value == nullptr || find(key) != nullptr)
+            return false;
+        if((m_size + 1) * 4 > m_slots.size() * 3)
+            rehash(m_slots.empty() ? MIN_CAPACITY : m_slots.size() * 2);
+        place(Slot{ key.packed, value, key.length });
+        m_size++;
+        return true;
+    }
+
+    /**
+     * @brief 移除一个键
+     *
+     * @return 被移除的指针，未找到时返回nullptr
+     */
+    T* erase(const Key& key) noexcept {
+        if(m_size == 0)
+            return nullptr;
+        auto i = Hash(key) & m_mask;
+        for(; m_slots[i].value != nullptr; i = (i + 1) & m_mask) {
+            if(m_slots[i].packed == key.packed && m_slots[i].length == key.length)
+                break;
+        }
+        auto value = m_slots[i].value;
+        if(value == nullptr)
+            return nullptr;
+        // 把探测链上后续的元素移到空位，只要它的起始位置不在空位与它之间
+        for(auto j = i; ; ) {
+            j = (j + 1) & m_mask;
+            if(m_slots[j].value == nullptr)
+                break;
+            auto home = Hash(Key{ m_slots[j].packed, m_slots[j].length }) & m_mask;
+            if(((j - home) & m_mask) >= ((j - i) & m_mask)) {
+                m_slots[i] = m_slots[j];
+                i = j;
+            }
+        }
+        m_slots[i].value = nullptr;
+        m_size--;
+        return value;
+    }
+
+    /**
+     * @brief 对每个保存的指针调用一次func，期间不能修改表
+     *
+     */
+    template<typename Func>
+    void forEach(Func&& func) const {
+        for(auto& slot : m_slots) {
+            if(slot.value != nullptr)
+                func(slot.value);
+        }
+    }
+
+    /**
+     * @brief 移除所有元素并释放表的内存
+     *
+     */
+    void clear() noexcept {
+        std::vector<Slot>().swap(m_slots);
+        m_mask = 0;
+        m_size = 0;
+    }
+
+    size_t size() const noexcept { return m_size; }
+    bool empty() const noexcept { return m_size == 0; }
+    size_t capacity() const noexcept { return m_slots.size(); }
+
+private:
+    struct Slot {
+        uint64_t packed = 0;
+        T* value = nullptr;     // 为空表示空位
+        uint8_t length = 0;
+    };
+
+    static constexpr size_t MIN_CAPACITY = 16;
+
+    static size_t Hash(const Key& key) noexcept {
+        // splitmix64的混合函数，libcoap生成的token是递增的，需要把变化扩散到低位
+        auto x = key.packed ^ (static_cast<uint64_t>(key.length) << 56);
+        x ^= x >> 30;
+        x *= 0xbf58476d1ce4e5b9ull;
+        x ^= x >> 27;
+        x *= 0x94d049bb133111ebull;
+        x ^= x >> 31;
+        return static_cast<size_t>(x);
+    }
+
+    void place(const Slot& slot) noexcept {
+        auto i = Hash(Key{ slot.packed, slot.length }) & m_mask;
+        while(m_slots[i].value != nullptr)
+            i = (i + 1) & m_mask;
+        m_slots[i] = slot;
+    }
+
+    void rehash(size_t capacity) {
+        std::vector<Slot> old(capacity);
+        old.swap(m_slots);
+        m_mask = capacity - 1;
+        for(auto& slot : old) {
+            if(slot.value != nullptr)
+                place(slot);
+        }
+    }
+
+private:
+    std::vector<Slot> m_slots;  // 容量总是2的幂
+    size_t m_mask = 0;
+    size_t m_size = 0;
+};
+
+} // namespace CoapPlusPlus
@@ -0,0 +1,112 @@
+#include <QtTest>
+#include <QDebug>
+#include <stdexcept>
+
+#include "coap/AdmissionController.h"
+
+using namespace CoapPlusPlus;
+
+class tst_AdmissionController : public QObject {
+    Q_OBJECT
+public:
+    tst_AdmissionController() { }
+    ~tst_AdmissionController() { }
+
+private:
+    static AdmissionController::Key peer(uint8_t last, uint16_t port, const void* resource = nullptr) {
+        AdmissionController::Key key;
+        key.family = 2;
+        key.ip = { 192, 168, 1, last };
+        key.port = port;
+        key.resource = resource;
+        return key;
+    }
+
+private slots:
+    void test_burstAndRefill(); // 测试突发容量与令牌补充
+    void test_isolation(); // 测试对等体、资源之间互不影响
+    void test_sweep(); // 测试补满的令牌桶被清理
+};
+
+void tst_AdmissionController::test_burstAndRefill()
+{
+    QVERIFY_EXCEPTION_THROWN(AdmissionController(0, 1), std::invalid_argument);
+    QVERIFY_EXCEPTION_THROWN(AdmissionController(1, 0), std::invalid_argument);
+
+    // 每秒2个令牌，最多积累3个
+    AdmissionController controller(2, 3);
+    uint32_t retry = 0;
+    auto key = peer(1, 5683);
+    for(int i = 0; i < 3; i++)
+        QVERIFY(controller.admit(key, 1000, retry));
+    QVERIFY(!controller.admit(key, 1000, retry));
+    QCOMPARE(retry, uint32_t(1));
+
+    // 500毫秒补充一个令牌
+    QVERIFY(!controller.admit(key, 1499, retry));
+    QVERIFY(controller.admit(key, 1500, retry));
+    QVERIFY(!controller.admit(key, 1500, retry));
+
+    // 很久之后最多只有burst个令牌
+    for(int i = 0; i < 3; i++)
+        QVERIFY(controller.admit(key, 100000, retry));
+    QVERIFY(!controller.admit(key, 100000, retry));
+
+    auto stats = controller.getStats();
+    QCOMPARE(stats.admitted, uint64_t(7));
+    QCOMPARE(stats.rejected, uint64_t(4));
+
+    // 速率很低时建议的重试时间更长
+    AdmissionController slow(0.1, 1);
+    QVERIFY(slow.admit(key, 0, retry));
+    QVERIFY(!slow.admit(key, 0, retry));
+    QCOMPARE(retry, uint32_t(10));
+}
+
+void tst_AdmissionController::test_isolation()
+{
+    AdmissionController controller(1, 1);
+    uint32_t retry = 0;
+    int a, b;
+    QVERIFY(controller.admit(peer(1, 5683), 0, retry));
+    QVERIFY(!controller.admit(peer(1, 5683), 0, retry));
+
+    // 同一地址的不同端口、不同地址都有各自的令牌桶
+    QVERIFY(controller.admit(peer(1, 5684), 0, retry));
+    QVERIFY(controller.admit(peer(2, 5683), 0, retry));
+
+    // 按资源区分时，同一对等体的不同资源互不影响
+    QVERIFY(controller.admit(peer(3, 5683, &a), 0, retry));
+    QVERIFY(controller.admit(peer(3, 5683, &b), 0, retry));
+    QVERIFY(!controller.admit(peer(3, 5683, &a), 0, retry));
+    QCOMPARE(controller.getStats().tracked, uint64_t(5));
+}
+
+void tst_AdmissionController::test_sweep()
+{
+    // 空桶补满需要2000毫秒
+    AdmissionController controller(1, 2);
+    uint32_t retry = 0;
+    for(uint8_t i = 0; i < 100; i++)
+        QVERIFY(controller.admit(peer(i, 5683), 0, retry));
+    QCOMPARE(controller.getStats().tracked, uint64_t(100));
+
+    // 每次请求只清理一部分，持续有请求时补满的桶逐步被清理，只有仍在活跃的对等体被保留
+    QVERIFY(controller.admit(peer(0, 5683), 1500, retry));
+    QVERIFY(controller.admit(peer(200, 5683), 2000, retry));
+    QVERIFY(controller.getStats().tracked > 2);
+    int calls = 1;
+    while(controller.getStats().tracked > 2 && calls < 1000) {
+        controller.admit(peer(200, 5683), 2000, retry);
+        calls++;
+    }
+    QCOMPARE(controller.getStats().tracked, uint64_t(2));
+
+    // 清理不影响仍在限流中的对等体
+    QVERIFY(controller.admit(peer(0, 5683), 2000, retry));
+    QVERIFY(!controller.admit(peer(0, 5683), 2000, retry));
+}
+
+QTEST_MAIN(tst_AdmissionController)
+
+#include "tst_AdmissionController.moc"
@@ -4,19 +4,19 @@
 namespace CoapPlusPlus
 {
     
-void TestEventHandling::onServerSessionConnected(Session session) noexcept
+void TestEventHandling::onServerSessionConnected(SessionView session) noexcept
 {
     Log::Logging(LOG_LEVEL::INFO, "TestEventHandling::onServerSessionConnected, port:%d\n", session.getRemoteAddress().getPort());
     m_connects->add(session.getRemoteAddress().getPort());
 }
 
-void TestEventHandling::onServerSessionClosed(Session session) noexcept
+void TestEventHandling::onServerSessionClosed(SessionView session) noexcept
 {
     Log::Logging(LOG_LEVEL::INFO, "TestEventHandling::onServerSessionClosed\n");
     m_connects->remove(session.getRemoteAddress().getPort());
 }
 
-void TestEventHandling::onKeepAliveFailured(Session session) noexcept
+void TestEventHandling::onKeepAliveFailured(SessionView session) noexcept
 {
     Log::Logging(LOG_LEVEL::INFO, "TestEventHandling::onKeepAliveFailured\n");
     m_connects->remove(session.getRemoteAddress().getPort());
@@ -1,7 +1,7 @@
 #pragma once
 
 #include "coap/EventHandling.h"
-#include "coap/Session.h"
+#include "coap/SessionView.h"
 #include "coap/Log.h"
 #include <set>
 
@@ -37,23 +37,23 @@ public:
     ~TestEventHandling() noexcept { }
 
 protected:
-    void onDtlsClosed(Session session) noexcept override {}
-    void onDtlsConnected(Session session) noexcept override {}
-    void onDtlsRenegotiation(Session session) noexcept override {}
-    void onDtlsError(Session session) noexcept override {}
-    void onTcpClosed(Session session) noexcept override {}
-    void onTcpConnected(Session session) noexcept override {}
-    void onTcpFailed(Session session) noexcept override {}
-    void onSessionClosed(Session session) noexcept override {}
-    void onSessionConnected(Session session) noexcept override {}
-    void onSessionFailed(Session session) noexcept override {}
-    void onPartialBlock(Session session) noexcept override {}
-    void onXmitBlockFail(Session session) noexcept override {}
-    void onServerSessionConnected(Session session) noexcept override ;
-    void onServerSessionClosed(Session session) noexcept override;
-    void onBadPacket(Session session) noexcept override {}
-    void onMSGRetransmit(Session session) noexcept override {}
-    void onKeepAliveFailured(Session session) noexcept override;
+    void onDtlsClosed(SessionView session) noexcept override {}
+    void onDtlsConnected(SessionView session) noexcept override {}
+    void onDtlsRenegotiation(SessionView session) noexcept override {}
+    void onDtlsError(SessionView session) noexcept override {}
+    void onTcpClosed(SessionView session) noexcept override {}
+    void onTcpConnected(SessionView session) noexcept override {}
+    void onTcpFailed(SessionView session) noexcept override {}
+    void onSessionClosed(SessionView session) noexcept override {}
+    void onSessionConnected(SessionView session) noexcept override {}
+    void onSessionFailed(SessionView session) noexcept override {}
+    void onPartialBlock(SessionView session) noexcept override {}
+    void onXmitBlockFail(SessionView session) noexcept override {}
+    void onServerSessionConnected(SessionView session) noexcept override ;
+    void onServerSessionClosed(SessionView session) noexcept override;
+    void onBadPacket(SessionView session) noexcept override {}
+    void onMSGRetransmit(SessionView session) noexcept override {}
+    void onKeepAliveFailured(SessionView session) noexcept override;
 
 private:
     ConncetState* m_connects = nullptr;
@@ -8,7 +8,11 @@
 #include "coap/DataStruct/Address.h"
 #include "coap/Pdu/ResponsePdu.h"
 #include "coap/Session.h"
+#include "coap/IOHub.h"
+#include <atomic>
 #include <functional>
+#include <memory>
+#include <thread>
 
 using namespace CoapPlusPlus;
 class tst_Communication : public QObject {
@@ -24,6 +28,7 @@ private:
 private slots:
     void test_client_connectState();
     void test_server_connectState();
+    void test_healthProbe(); // 测试每个Context各自的握手响应处理函数以及会话的健康探测
 };
 
 QTEST_MAIN(tst_Communication)
@@ -77,7 +82,7 @@ void tst_Communication::test_server_connectState()
 {
     ConncetState state; 
     _client.registerEventHandling(std::make_unique<TestEventHandling>(&state));
-    _client.registerHandshakeResponedFunction([&state](const CoapPlusPlus::Session* session, 
+    _client.registerHandshakeResponedFunction([&state](const CoapPlusPlus::SessionView* session, 
                                                 const CoapPlusPlus::ResponsePdu* response, int id) 
     {
         if(session) {
@@ -104,3 +109,86 @@ void tst_Communication::test_server_connectState()
     QCOMPARE( state.getConnectedAddress().size(), 1 );
     QVERIFY( state.isConnect(session->getRemoteAddress().getPort()) );
 }
+
+void tst_Communication::test_healthProbe()
+{
+    ContextServer server1;
+    auto server2 = std::make_unique<ContextServer>();
+    QVERIFY( server1.addEndPoint(5790, Information::Udp) );
+    QVERIFY( server2->addEndPoint(5791, Information::Udp) );
+    QVERIFY( server1.startIOProcess(10) );
+    QVERIFY( server2->startIOProcess(10) );
+
+    // 两个客户端的处理函数互不覆盖
+    ContextClient client1, client2;
+    std::atomic<int> pongs1 = 0, pongs2 = 0;
+    client1.registerHandshakeResponedFunction([&pongs1](const SessionView*, const ResponsePdu*, int) { pongs1++; });
+    client2.registerHandshakeResponedFunction([&pongs2](const SessionView*, const ResponsePdu*, int) { pongs2++; });
+
+    QVERIFY( client1.addSession(5790, Information::Udp) );
+    QVERIFY( client1.addSession(5791, Information::Udp) );
+    QVERIFY( client2.addSession(5790, Information::Udp) );
+    HealthProbe::Options options;
+    options.timeoutMs = 80;
+    options.maxLosses = 2;
+    std::atomic<int> unhealthyPort = 0;
+    QVERIFY( client1.setHealthProbe(100, options, [&unhealthyPort](uint16_t port, Information::Protocol, bool healthy) {
+        if(healthy == false)
+            unhealthyPort = port;
+    }) );
+    QVERIFY( client2.setHealthProbe(100, options) );
+    QVERIFY( client1.startIOProcess(10) );
+    QVERIFY( client2.startIOProcess(10) );
+    QVERIFY( !client1.setHealthProbe(100, options) );
+
+    // 探测进行期间可以在其他线程中查询
+    std::atomic<bool> stopReading = false;
+    std::thread reader([&client1, &stopReading]() {
+        HealthProbe::Health health;
+        while(stopReading == false) {
+            client1.getPeerHealth(5790, Information::Udp, health);
+            client1.getAllPeerHealth();
+        }
+    });
+    QTest::qWait(600);
+    stopReading = true;
+    reader.join();
+    QVERIFY( pongs1 > 0 );
+    QVERIFY( pongs2 > 0 );
+    HealthProbe::Health health;
+    QVERIFY( client1.getPeerHealth(5790, Information::Udp, health) );
+    QVERIFY( health.healthy );
+    QVERIFY( health.received > 0 );
+    QVERIFY( client1.getPeerHealth(5791, Information::Udp, health) );
+    QVERIFY( health.healthy );
+    QVERIFY( !client2.getPeerHealth(5791, Information::Udp, health) );
+
+    // 一个服务器下线后，只有它的会话被标记为不健康
+    server2.reset();
+    QTest::qWait(800);
+    QCOMPARE( unhealthyPort.load(), 5791 );
+    QVERIFY( client1.getPeerHealth(5791, Information::Udp, health) );
+    QVERIFY( !health.healthy );
+    QVERIFY( health.consecutiveLosses >= options.maxLosses );
+    auto all = client1.getAllPeerHealth();
+    QCOMPARE( all.size(), size_t(2) );
+    QCOMPARE( all.front().port, uint16_t(5790) );
+    QVERIFY( all.front().health.healthy );
+    QCOMPARE( all.back().port, uint16_t(5791) );
+
+    client1.stopIOProcess();
+    client2.stopIOProcess();
+    QVERIFY( client1.setHealthProbe(0) );
+    QVERIFY( client1.getAllPeerHealth().empty() );
+
+    // 加入IOHub后由集线器的线程进行探测，不能重新设置
+#ifdef __linux__
+    if(client2.getFileDescriptor() >= 0) {
+        IOHub hub;
+        QVERIFY( hub.addContext(client2) );
+        QVERIFY( !client2.setHealthProbe(0) );
+        QVERIFY( hub.removeContext(client2) );
+    }
+#endif
+    QVERIFY( client2.setHealthProbe(0) );
+}
@@ -0,0 +1,141 @@
+#include <QtTest>
+#include <QDebug>
+#include <stdexcept>
+#include <vector>
+
+#include "coap/HealthProbe.h"
+
+using namespace CoapPlusPlus;
+
+class tst_HealthProbe : public QObject {
+    Q_OBJECT
+public:
+    tst_HealthProbe() { }
+    ~tst_HealthProbe() { }
+
+private slots:
+    void test_rtt(); // 测试往返时间的平滑与pong的匹配
+    void test_losses(); // 测试连续丢失后标记为不健康以及恢复
+    void test_ordering(); // 测试按往返时间和健康状况排序
+};
+
+void tst_HealthProbe::test_rtt()
+{
+    HealthProbe::Options options;
+    options.timeoutMs = 0;
+    QVERIFY_EXCEPTION_THROWN(HealthProbe{ options }, std::invalid_argument);
+    options.timeoutMs = 1000;
+    options.alpha = 0;
+    QVERIFY_EXCEPTION_THROWN(HealthProbe{ options }, std::invalid_argument);
+
+    options.alpha = 0.5;
+    HealthProbe probe(options);
+    HealthProbe::Health health;
+    QVERIFY(!probe.getHealth(1, health));
+
+    // 第一个样本直接作为平滑往返时间
+    probe.onSent(1, 10, 1000);
+    QVERIFY(probe.isProbing(1));
+    QVERIFY(!probe.onPong(1, 11, 1020));
+    QVERIFY(probe.onPong(1, 10, 1020));
+    QVERIFY(!probe.isProbing(1));
+    QVERIFY(probe.getHealth(1, health));
+    QCOMPARE(health.lastRttMs, uint32_t(20));
+    QCOMPARE(health.rttMs, 20.0);
+
+    // 之后按alpha加权
+    probe.onSent(1, 12, 2000);
+    QVERIFY(probe.onPong(1, 12, 2040));
+    QVERIFY(probe.getHealth(1, health));
+    QCOMPARE(health.rttMs, 30.0);
+    QCOMPARE(health.sent, uint64_t(2));
+    QCOMPARE(health.received, uint64_t(2));
+
+    // 重复的pong不再匹配
+    QVERIFY(!probe.onPong(1, 12, 2050));
+}
+
+void tst_HealthProbe::test_losses()
+{
+    HealthProbe::Options options;
+    options.timeoutMs = 100;
+    options.maxLosses = 2;
+    options.maxRttMs = 50;
+    std::vector<std::pair<HealthProbe::PeerId, bool>> changes;
+    HealthProbe probe(options, [&changes](HealthProbe::PeerId peer, bool healthy) { changes.emplace_back(peer, healthy); });
+    HealthProbe::Health health;
+
+    // 未到期的ping不算丢失
+    probe.onSent(7, 1, 0);
+    probe.expire(99);
+    QVERIFY(probe.isProbing(7));
+    probe.expire(100);
+    QVERIFY(!probe.isProbing(7));
+    QVERIFY(probe.getHealth(7, health));
+    QVERIFY(health.healthy);
+    QCOMPARE(health.consecutiveLosses, uint32_t(1));
+
+    // 超时之后才到达的pong不计入
+    QVERIFY(!probe.onPong(7, 1, 150));
+    probe.onSent(7, 2, 200);
+    probe.expire(300);
+    QVERIFY(probe.getHealth(7, health));
+    QVERIFY(!health.healthy);
+    QCOMPARE(health.lost, uint64_t(2));
+    QCOMPARE(changes.size(), size_t(1));
+    QVERIFY(changes.back() == std::make_pair(HealthProbe::PeerId(7), false));
+
+    // 往返时间过大的pong不能恢复健康
+    probe.onSent(7, 3, 400);
+    QVERIFY(probe.onPong(7, 3, 480));
+    QVERIFY(probe.getHealth(7, health));
+    QVERIFY(!health.healthy);
+    QCOMPARE(health.consecutiveLosses, uint32_t(0));
+
+    // 平滑往返时间降下来后恢复健康
+    for(int i = 0; i < 10 && !health.healthy; i++) {
+        probe.onSent(7, 4 + i, 1000 + i * 100);
+        QVERIFY(probe.onPong(7, 4 + i, 1000 + i * 100 + 5));
+        QVERIFY(probe.getHealth(7, health));
+    }
+    QVERIFY(health.healthy);
+    QCOMPARE(changes.size(), size_t(2));
+    QVERIFY(changes.back() == std::make_pair(HealthProbe::PeerId(7), true));
+
+    probe.removePeer(7);
+    QVERIFY(!probe.getHealth(7, health));
+}
+
+void tst_HealthProbe::test_ordering()
+{
+    HealthProbe::Options options;
+    options.timeoutMs = 100;
+    options.maxLosses = 1;
+    HealthProbe probe(options);
+    probe.onSent(1, 1, 0);
+    QVERIFY(probe.onPong(1, 1, 30));
+    probe.onSent(2, 1, 0);
+    QVERIFY(probe.onPong(2, 1, 10));
+    probe.onSent(3, 1, 0);
+    probe.onSent(4, 1, 0);
+    QVERIFY(probe.onPong(4, 1, 5));
+    probe.expire(100);
+
+    // 健康且有样本的按往返时间排列，其次是没有样本的，不健康的在最后
+    auto all = probe.getAllHealth();
+    QCOMPARE(all.size(), size_t(4));
+    QCOMPARE(all[0].first, HealthProbe::PeerId(4));
+    QCOMPARE(all[1].first, HealthProbe::PeerId(2));
+    QCOMPARE(all[2].first, HealthProbe::PeerId(1));
+    QCOMPARE(all[3].first, HealthProbe::PeerId(3));
+    QVERIFY(!all[3].second.healthy);
+
+    probe.onSent(5, 1, 200);
+    all = probe.getAllHealth();
+    QCOMPARE(all[3].first, HealthProbe::PeerId(5));
+    QCOMPARE(all[4].first, HealthProbe::PeerId(3));
+}
+
+QTEST_MAIN(tst_HealthProbe)
+
+#include "tst_HealthProbe.moc"
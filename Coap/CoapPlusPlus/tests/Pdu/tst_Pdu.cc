@@ -378,6 +378,13 @@ void tst_Pdu::test_requestPdu()
     auto payloadData = QByteArray((const char*)request.payload().data().data(), request.payload().size());
     QCOMPARE(payloadData.toInt(), 1234);
 
+    // 测试按收到的报文构造RequestPdu：token引用报文中的数据，负载格式直接从选项中读取
+    auto rawToken = coap_pdu_get_token(pdu);
+    RequestPdu received(pdu, BinaryConst::Reference(&rawToken));
+    QCOMPARE(received.token(), tokenView);
+    QCOMPARE(received.payload(), payload);
+    QCOMPARE(received.payload().type(), Information::OctetStream);
+
     Pdu::LogPdu(LOG_LEVEL::INFO, &request);
     coap_delete_pdu(pdu);
 }
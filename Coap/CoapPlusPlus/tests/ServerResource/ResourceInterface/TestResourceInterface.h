@@ -2,7 +2,7 @@
 
 #include <coap3/coap.h>
 #include "coap/ResourceInterface.h"
-#include "coap/Session.h"
+#include "coap/SessionView.h"
 #include "coap/DataStruct/Address.h"
 #include "coap/Pdu/RequestPdu.h"
 #include "coap/Pdu/ResponsePdu.h"
@@ -32,7 +32,7 @@ public:
 
     ~TestResourceInterface() noexcept { }
 
-    void onRequest(Session session, std::string query, ResponsePdu response, RequestPdu request) override
+    void onRequest(SessionView session, std::string query, ResponsePdu response, RequestPdu request) override
     {
         auto code = request.code();
         switch (code)
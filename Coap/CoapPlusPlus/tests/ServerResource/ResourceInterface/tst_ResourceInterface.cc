@@ -3,6 +3,12 @@
 #include <QDebug>
 #include <QByteArray>
 #include <QString>
+#include <QElapsedTimer>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include <vector>
 
 #include <coap3/coap.h>
 #include "coap/ContextServer.h"
@@ -10,10 +16,36 @@
 #include "coap/Resource.h"
 #include "coap/exception.h"
 #include "coap/ResourceInterface.h"
+#include "coap/IOHub.h"
 #include "TestResourceInterface.h"
 
 using namespace CoapPlusPlus;
 
+/**
+ * @brief 等待一段时间后回应一段文本的资源回应接口
+ */
+class TextResourceInterface : public ResourceInterface {
+public:
+    TextResourceInterface(std::string text, int delayMs, std::atomic<std::thread::id>* thread, std::atomic<bool>* readOnly = nullptr) noexcept 
+        : ResourceInterface(Information::RequestCode::Get), m_text(text), m_delayMs(delayMs), m_thread(thread), m_readOnly(readOnly) {  }
+
+    void onRequest(SessionView session, std::string query, ResponsePdu response, RequestPdu request) override
+    {
+        *m_thread = std::this_thread::get_id();
+        if(m_readOnly)
+            *m_readOnly = session.isReadOnly() && session.getProtocol() == Information::Udp;
+        std::this_thread::sleep_for(std::chrono::milliseconds(m_delayMs));
+        response.setCode(Information::Content);
+        response.setPayload(Payload(m_text.size(), (const uint8_t*)m_text.data(), Information::TextPlain));
+    }
+
+private:
+    std::string m_text;
+    int m_delayMs = 0;
+    std::atomic<std::thread::id>* m_thread = nullptr;
+    std::atomic<bool>* m_readOnly = nullptr;
+};
+
 class tst_ResourceInterface : public QObject
 {
     Q_OBJECT
@@ -55,8 +87,19 @@ private:
 private:    
     int _port = 5683;
 
+    bool sendGet(const std::string& path, coap_session_t* session = nullptr, bool observe = false);
+    static coap_response_t responseHandler(coap_session_t* session, const coap_pdu_t* sent, const coap_pdu_t* received, const coap_mid_t mid);
+    static std::vector<std::pair<std::string, int>> s_responses; // 收到的响应的payload和code
+
 private slots:
     void test_Interface();
+    void test_AsyncInterface(); // 测试异步资源的独立响应
+    void test_NotImplemented(); // 测试未注册回应接口的请求码
+    void test_RateLimit(); // 测试按对等体限流
+    void test_InFlightLimit(); // 测试处理中的交互数量上限
+    void test_NotifyFromThread(); // 测试在其他线程中通知观察者
+    void test_DrainInIOHub(); // 测试加入IOHub的服务器的排空
+    void test_Drain(); // 测试服务器排空，必须最后执行
 
 };
 
@@ -64,6 +107,91 @@ QTEST_MAIN(tst_ResourceInterface)
 
 #include "tst_ResourceInterface.moc"
 
+std::vector<std::pair<std::string, int>> tst_ResourceInterface::s_responses;
+
+coap_response_t tst_ResourceInterface::responseHandler(coap_session_t* session, const coap_pdu_t* sent, const coap_pdu_t* received, const coap_mid_t mid)
+{
+    size_t length = 0;
+    const uint8_t* data = nullptr;
+    coap_get_data(received, &length, &data);
+    s_responses.emplace_back(std::string((const char*)data, length), coap_pdu_get_code(received));
+    return COAP_RESPONSE_OK;
+}
+
+bool tst_ResourceInterface::sendGet(const std::string& path, coap_session_t* session, bool observe)
+{
+    if(session == nullptr)
+        session = m_session;
+    // 可能在客户端线程中调用，不能使用QVERIFY
+    coap_pdu_t *request = coap_new_pdu(COAP_MESSAGE_CON, COAP_REQUEST_CODE_GET, session);
+    size_t size;
+    uint8_t tokenData[8];
+    coap_session_new_token(session, &size, tokenData);
+    coap_add_token(request, size, tokenData);
+    coap_uri_t uri;
+    uint8_t buf[1024];
+    coap_optlist_t *optList = nullptr;
+    uint8_t observeBuf[4];
+    if(observe)
+        coap_insert_optlist(&optList, coap_new_optlist(COAP_OPTION_OBSERVE,
+                            coap_encode_var_safe(observeBuf, sizeof(observeBuf), COAP_OBSERVE_ESTABLISH), observeBuf));
+    bool result = coap_split_uri((uint8_t *)path.c_str(), path.size(), &uri) == 0
+                && coap_uri_into_options(&uri, &optList, 1, buf, sizeof(buf)) == 0
+                && coap_add_optlist_pdu(request, &optList) == 1;
+    coap_delete_optlist(optList);
+    if(result == false) {
+        coap_delete_pdu(request);
+        return false;
+    }
+    return coap_send(session, request) != COAP_INVALID_MID;
+}
+
+void tst_ResourceInterface::test_AsyncInterface()
+{
+    std::atomic<std::thread::id> slowThread;
+    std::atomic<std::thread::id> fastThread;
+    std::atomic<bool> slowReadOnly = false;
+    std::atomic<bool> fastReadOnly = true;
+    auto slow = std::make_unique<Resource>("coapcpp/test/slow");
+    QVERIFY(slow->enableAsynchronous(true));
+    slow->registerInterface(std::make_unique<TextResourceInterface>("slow", 300, &slowThread, &slowReadOnly));
+    auto fast = std::make_unique<Resource>("coapcpp/test/fast");
+    fast->registerInterface(std::make_unique<TextResourceInterface>("fast", 0, &fastThread, &fastReadOnly));
+    QVERIFY(_manager->registerResource(std::move(slow)));
+    QVERIFY(_manager->registerResource(std::move(fast)));
+    QVERIFY(_server.setAsyncWorkerCount(2));
+
+    s_responses.clear();
+    coap_register_response_handler(m_context, responseHandler);
+    QVERIFY(_server.startIOProcess(0));
+    QElapsedTimer timer;
+    timer.start();
+    QVERIFY(sendGet("/coapcpp/test/slow"));
+    QVERIFY(sendGet("/coapcpp/test/fast"));
+
+    // 慢的异步请求不能阻塞快的同步请求
+    qint64 fastElapsed = -1;
+    while(s_responses.size() < 2 && timer.elapsed() < 3000) {
+        coap_io_process(m_context, 10);
+        if(fastElapsed < 0 && s_responses.size() == 1)
+            fastElapsed = timer.elapsed();
+    }
+    QCOMPARE(s_responses.size(), size_t(2));
+    QCOMPARE(s_responses[0].first, std::string("fast"));
+    QVERIFY2(fastElapsed < 200, "同步请求被异步请求阻塞");
+    QCOMPARE(s_responses[1].first, std::string("slow"));
+    QCOMPARE(s_responses[1].second, int(COAP_RESPONSE_CODE(205)));
+    QVERIFY(timer.elapsed() >= 300);
+    QVERIFY2(slowThread.load() != fastThread.load(), "异步请求没有在工作线程中处理");
+    QVERIFY2(slowReadOnly, "工作线程中的会话视图应该是只读的快照");
+    QVERIFY2(!fastReadOnly, "同步请求的会话视图不应该是只读的");
+    QVERIFY2(!_server.setAsyncWorkerCount(4), "工作线程池已经创建，预期返回false");
+    QTRY_COMPARE_WITH_TIMEOUT(_server.getAsyncPendingCount(), size_t(0), 100);
+    _server.stopIOProcess();
+    QVERIFY(_manager->unregisterResource("coapcpp/test/slow"));
+    QVERIFY(_manager->unregisterResource("coapcpp/test/fast"));
+}
+
 void tst_ResourceInterface::test_Interface()
 {
     TestResourceInterfaceData data(1);
@@ -96,4 +224,279 @@ void tst_ResourceInterface::test_Interface()
 
     // 检查响应
     QCOMPARE(data.number(), 2);
+}
+
+void tst_ResourceInterface::test_NotImplemented()
+{
+    TestResourceInterfaceData data(1);
+    auto resource = std::make_unique<Resource>("coapcpp/test/putonly");
+    resource->registerInterface(std::make_unique<TestResourceInterface>(&data, Information::RequestCode::Put));
+    QVERIFY(_manager->registerResource(std::move(resource)));
+
+    s_responses.clear();
+    coap_register_response_handler(m_context, responseHandler);
+    QVERIFY(_server.startIOProcess(0));
+    QVERIFY(sendGet("/coapcpp/test/putonly"));
+    QElapsedTimer timer;
+    timer.start();
+    while(s_responses.empty() && timer.elapsed() < 1000)
+        coap_io_process(m_context, 10);
+    _server.stopIOProcess();
+    QCOMPARE(s_responses.size(), size_t(1));
+    QCOMPARE(s_responses[0].second, int(COAP_RESPONSE_CODE(501)));
+    QVERIFY(_manager->unregisterResource("coapcpp/test/putonly"));
+}
+
+void tst_ResourceInterface::test_RateLimit()
+{
+    std::atomic<std::thread::id> thread;
+    auto resource = std::make_unique<Resource>("coapcpp/test/limited");
+    resource->registerInterface(std::make_unique<TextResourceInterface>("limited", 0, &thread));
+    QVERIFY(_manager->registerResource(std::move(resource)));
+    QVERIFY(_server.setRateLimit(0.5, 2));
+
+    s_responses.clear();
+    coap_register_response_handler(m_context, responseHandler);
+    QVERIFY(_server.startIOProcess(0));
+    QVERIFY2(!_server.setRateLimit(1), "I/O线程正在运行，预期返回false");
+    for(int i = 0; i < 3; i++)
+        QVERIFY(sendGet("/coapcpp/test/limited"));
+    QElapsedTimer timer;
+    timer.start();
+    while(s_responses.size() < 3 && timer.elapsed() < 2000)
+        coap_io_process(m_context, 10);
+    _server.stopIOProcess();
+
+    // 突发容量内的请求正常回应，超出的请求在调用回应接口之前被拒绝
+    QCOMPARE(s_responses.size(), size_t(3));
+    auto limited = std::count_if(s_responses.begin(), s_responses.end(), [](const auto& r) { return r.second == int(COAP_RESPONSE_CODE(429)); });
+    QCOMPARE(limited, std::ptrdiff_t(1));
+    auto stats = _server.getAdmissionStats();
+    QCOMPARE(stats.admitted, uint64_t(2));
+    QCOMPARE(stats.rejected, uint64_t(1));
+    QCOMPARE(stats.tracked, uint64_t(1));
+
+    // 加入IOHub后由集线器的线程使用令牌桶，不能重新设置
+#ifdef __linux__
+    if(_server.getFileDescriptor() >= 0) {
+        IOHub hub;
+        QVERIFY(hub.addContext(_server));
+        QVERIFY(!_server.setRateLimit(1));
+        QCOMPARE(_server.getAdmissionStats().admitted, uint64_t(2));
+        QVERIFY(hub.removeContext(_server));
+    }
+#endif
+    QVERIFY(_server.setRateLimit(0));
+    QCOMPARE(_server.getAdmissionStats().rejected, uint64_t(0));
+    QVERIFY(_manager->unregisterResource("coapcpp/test/limited"));
+}
+
+void tst_ResourceInterface::test_InFlightLimit()
+{
+    std::atomic<std::thread::id> thread;
+    auto slow = std::make_unique<Resource>("coapcpp/test/inflight");
+    QVERIFY(slow->enableAsynchronous(true));
+    slow->registerInterface(std::make_unique<TextResourceInterface>("inflight", 300, &thread));
+    QVERIFY(_manager->registerResource(std::move(slow)));
+    QVERIFY2(!_server.setInFlightLimit(1, 1), "低水位不小于上限，预期返回false");
+    std::vector<std::pair<bool, size_t>> events;
+    QVERIFY(_server.setInFlightLimit(1, 0, [&events](bool overloaded, size_t inFlight) { events.emplace_back(overloaded, inFlight); }));
+
+    s_responses.clear();
+    coap_register_response_handler(m_context, responseHandler);
+    QVERIFY(_server.startIOProcess(0));
+    QVERIFY(sendGet("/coapcpp/test/inflight"));
+    QTRY_VERIFY_WITH_TIMEOUT(_server.isOverloaded(), 1000);
+    QVERIFY2(!_server.setInFlightLimit(0), "I/O线程正在运行，预期返回false");
+    QVERIFY(sendGet("/coapcpp/test/inflight"));
+    QElapsedTimer timer;
+    timer.start();
+    while(s_responses.size() < 2 && timer.elapsed() < 2000)
+        coap_io_process(m_context, 10);
+    QTRY_COMPARE_WITH_TIMEOUT(_server.getAsyncPendingCount(), size_t(0), 100);
+    _server.stopIOProcess();
+
+    // 超出上限的请求立刻被拒绝，已经接受的交互正常完成
+    QCOMPARE(s_responses.size(), size_t(2));
+    QCOMPARE(s_responses[0].second, int(COAP_RESPONSE_CODE(503)));
+    QCOMPARE(s_responses[1].first, std::string("inflight"));
+    QCOMPARE(_server.getInFlightRejectedCount(), uint64_t(1));
+    QVERIFY(!_server.isOverloaded());
+    QCOMPARE(events.size(), size_t(2));
+    QVERIFY(events[0].first);
+    QCOMPARE(events[0].second, size_t(1));
+    QVERIFY(!events[1].first);
+    QCOMPARE(events[1].second, size_t(0));
+
+    // 加入IOHub后由集线器的线程使用上限和观察函数，不能重新设置
+#ifdef __linux__
+    if(_server.getFileDescriptor() >= 0) {
+        IOHub hub;
+        QVERIFY(hub.addContext(_server));
+        QVERIFY(!_server.setInFlightLimit(0));
+        QCOMPARE(_server.getInFlightLimit(), size_t(1));
+        QVERIFY(hub.removeContext(_server));
+    }
+#endif
+    QVERIFY(_server.setInFlightLimit(0));
+    QVERIFY(_manager->unregisterResource("coapcpp/test/inflight"));
+}
+
+void tst_ResourceInterface::test_NotifyFromThread()
+{
+    std::atomic<std::thread::id> thread;
+    auto observed = std::make_unique<Resource>("coapcpp/test/observed", true);
+    observed->registerInterface(std::make_unique<TextResourceInterface>("observed", 0, &thread));
+    auto resource = observed.get();
+    QVERIFY(_manager->registerResource(std::move(observed)));
+
+    s_responses.clear();
+    coap_register_response_handler(m_context, responseHandler);
+    QVERIFY(_server.startIOProcess(0));
+    QVERIFY(sendGet("/coapcpp/test/observed", nullptr, true));
+    QElapsedTimer timer;
+    timer.start();
+    while(s_responses.empty() && timer.elapsed() < 2000)
+        coap_io_process(m_context, 10);
+    QCOMPARE(s_responses.size(), size_t(1));
+
+    // 多个线程同时通知，观察者状态只在I/O线程中修改，通知仍然被发送
+    std::vector<std::thread> notifiers;
+    for(int i = 0; i < 4; i++) {
+        notifiers.emplace_back([resource] {
+            for(int j = 0; j < 100; j++)
+                resource->notifyObserver();
+        });
+    }
+    for(auto& notifier : notifiers)
+        notifier.join();
+    timer.restart();
+    while(s_responses.size() < 2 && timer.elapsed() < 2000)
+        coap_io_process(m_context, 10);
+    _server.stopIOProcess();
+    QVERIFY(s_responses.size() >= 2);
+    QCOMPARE(s_responses.back().first, std::string("observed"));
+
+    // 排队期间资源被注销，通知被丢弃
+    resource->notifyObserver();
+    QVERIFY(_manager->unregisterResource("coapcpp/test/observed"));
+    QVERIFY(_server.ioProcess(-1) >= 0);
+}
+
+void tst_ResourceInterface::test_DrainInIOHub()
+{
+#ifdef __linux__
+    ContextServer server;
+    if(server.getFileDescriptor() < 0)
+        QSKIP("libcoap不支持epoll");
+    QVERIFY(server.addEndPoint(_port + 1));
+    std::atomic<std::thread::id> slowThread;
+    auto slow = std::make_unique<Resource>("coapcpp/test/hubdrain");
+    QVERIFY(slow->enableAsynchronous(true));
+    slow->registerInterface(std::make_unique<TextResourceInterface>("hub", 300, &slowThread));
+    QVERIFY(server.getResourceManager().registerResource(std::move(slow)));
+    IOHub hub;
+    QVERIFY(hub.addContext(server));
+    QVERIFY(server.isInIOHub());
+    QVERIFY(hub.start());
+
+    coap_address_t address;
+    coap_address_init(&address);
+    address.addr.sin.sin_family = AF_INET;
+    address.addr.sin.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    address.addr.sin.sin_port = htons(_port + 1);
+    auto session = coap_new_client_session(m_context, nullptr, &address, COAP_PROTO_UDP);
+    QVERIFY(session);
+    s_responses.clear();
+    coap_register_response_handler(m_context, responseHandler);
+    QVERIFY(sendGet("/coapcpp/test/hubdrain", session));
+    QElapsedTimer timer;
+    timer.start();
+    while(server.getAsyncPendingCount() == 0 && timer.elapsed() < 2000)
+        coap_io_process(m_context, 10);
+    QCOMPARE(server.getAsyncPendingCount(), size_t(1));
+
+    // 网络I/O仍由集线器的线程进行，drain()只在调用线程中等待
+    std::atomic<bool> stop = false;
+    std::thread client([&] {
+        while(stop == false)
+            coap_io_process(m_context, 10);
+    });
+    timer.restart();
+    auto drained = server.drain(3000);
+    auto elapsed = timer.elapsed();
+    stop = true;
+    client.join();
+
+    QVERIFY2(drained, "服务器没有在超时前排空");
+    QVERIFY(elapsed < 3000);
+    QVERIFY(hub.isRunning());
+    QVERIFY(server.isInIOHub());
+    QCOMPARE(server.getAsyncPendingCount(), size_t(0));
+    QCOMPARE(s_responses.size(), size_t(1));
+    QCOMPARE(s_responses[0].first, std::string("hub"));
+    hub.stop();
+    coap_session_release(session);
+#else
+    QSKIP("IOHub仅支持Linux");
+#endif
+}
+
+void tst_ResourceInterface::test_Drain()
+{
+    std::atomic<std::thread::id> slowThread;
+    std::atomic<std::thread::id> fastThread;
+    auto slow = std::make_unique<Resource>("coapcpp/test/drain/slow");
+    QVERIFY(slow->enableAsynchronous(true));
+    slow->registerInterface(std::make_unique<TextResourceInterface>("slow", 300, &slowThread));
+    auto fast = std::make_unique<Resource>("coapcpp/test/drain/fast");
+    fast->registerInterface(std::make_unique<TextResourceInterface>("fast", 0, &fastThread));
+    QVERIFY(_manager->registerResource(std::move(slow)));
+    QVERIFY(_manager->registerResource(std::move(fast)));
+
+    s_responses.clear();
+    coap_register_response_handler(m_context, responseHandler);
+    QVERIFY(_server.startIOProcess(0));
+
+    // 在网络I/O的回调中排空会立刻失败，不会停止I/O线程，也不会进入排空状态
+    std::atomic<int> inCallback = -1;
+    QElapsedTimer callbackTimer;
+    callbackTimer.start();
+    _server.addTimer(0, [this, &inCallback] { inCallback = _server.drain(3000) ? 1 : 0; });
+    QTRY_COMPARE_WITH_TIMEOUT(inCallback.load(), 0, 1000);
+    QVERIFY(callbackTimer.elapsed() < 1000);
+    QVERIFY(!_server.isDraining());
+    QVERIFY(_server.isIOProcessRunning());
+
+    QVERIFY(sendGet("/coapcpp/test/drain/slow"));
+    while(_server.getAsyncPendingCount() == 0)
+        coap_io_process(m_context, 10);
+
+    // drain()会阻塞当前线程，客户端在另一个线程中收发
+    std::atomic<bool> stop = false;
+    std::atomic<bool> sent = false;
+    std::thread client([&] {
+        while(stop == false) {
+            if(sent == false && _server.isDraining())
+                sent = sendGet("/coapcpp/test/drain/fast");
+            coap_io_process(m_context, 10);
+        }
+    });
+    QElapsedTimer timer;
+    timer.start();
+    auto drained = _server.drain(3000);
+    auto elapsed = timer.elapsed();
+    stop = true;
+    client.join();
+
+    QVERIFY2(drained, "服务器没有在超时前排空");
+    QVERIFY(elapsed < 3000);
+    QVERIFY(!_server.isIOProcessRunning());
+    QVERIFY(sent);
+    QCOMPARE(_server.getAsyncPendingCount(), size_t(0));
+    QCOMPARE(s_responses.size(), size_t(2));
+    // 排空期间新的请求被拒绝，已经开始的异步请求正常回应
+    QCOMPARE(s_responses[0].second, int(COAP_RESPONSE_CODE(503)));
+    QCOMPARE(s_responses[1].first, std::string("slow"));
+    QCOMPARE(s_responses[1].second, int(COAP_RESPONSE_CODE(205)));
 }
\ No newline at end of file
@@ -3,13 +3,28 @@
 #include <QDebug>
 #include <QByteArray>
 #include <QString>
+#include <QElapsedTimer>
+#include <atomic>
+#include <cstring>
+#include <thread>
 
 #include <coap3/coap.h>
 #include "coap/ContextServer.h"
+#include "coap/ContextServerGroup.h"
 #include "coap/ResourceManager.h"
 #include "coap/Resource.h"
 #include "coap/exception.h"
 #include "coap/ResourceInterface.h"
+#include "coap/Clock.h"
+#include "coap/IOHub.h"
+
+#ifdef __linux__
+#include <sys/epoll.h>
+#include <sys/resource.h>
+#include <sys/syscall.h>
+#include <sched.h>
+#include <unistd.h>
+#endif
 
 using namespace CoapPlusPlus;
 
@@ -45,6 +60,16 @@ private:
 
 private slots:
     void test_ContextServer();
+    void test_IOProcessThread(); // 测试I/O线程的启动和停止
+    void test_ExternalEventLoop(); // 测试接入外部事件循环
+    void test_ContextServerGroup(); // 测试多核分片的服务器组
+    void test_Timer(); // 测试Context的定时器
+    void test_ManualClock(); // 测试手动推进的时钟
+    void test_IOThreadOptions(); // 测试I/O线程的CPU亲和性和调度配置
+    void test_IOHub(); // 测试多个Context共享一个I/O线程
+    void test_ReadAhead(); // 测试网络I/O处理之后预读数据报
+    void test_BusyPoll(); // 测试I/O线程的忙轮询模式
+    void test_ShutdownDuringIOProcess(); // 测试ioProcess()进行中关闭和析构Context
     void test_ResourceRegister(); // 测试资源的注册和注销
     void test_Resource(); // 测试资源的基本接口
     //void test_ResourceInterface(); // todo: 等实现了class Session再测试资源回应接口
@@ -64,6 +89,476 @@ void tst_ServerResource::test_ContextServer()
     QVERIFY2(_server.ioProcess() >= 0, "数据已准备好，预期可以开始IO处理返回true，实际返回false");
 }
 
+void tst_ServerResource::test_IOProcessThread()
+{
+    std::atomic<int> count = 0;
+    _server.registerIOProcessObserver([&count](int ms) { 
+        QVERIFY(ms >= 0);
+        count++; 
+    });
+    QVERIFY(!_server.isIOProcessRunning());
+    QVERIFY2(_server.startIOProcess(50), "启动I/O线程失败");
+    QVERIFY(_server.isIOProcessRunning());
+    QVERIFY2(!_server.startIOProcess(50), "I/O线程已经在运行，预期返回false，实际返回true");
+    QCOMPARE(_server.ioProcess(), -1);
+    QTRY_VERIFY_WITH_TIMEOUT(count > 2, 1000);
+
+    // 无限等待的I/O线程也要能及时停止
+    _server.stopIOProcess();
+    QVERIFY(!_server.isIOProcessRunning());
+    QVERIFY(_server.startIOProcess(0));
+    QTest::qWait(50);
+
+    // 唤醒阻塞中的I/O线程
+    auto before = count.load();
+    _server.wakeup();
+    QTRY_VERIFY_WITH_TIMEOUT(count > before, 50);
+
+    QElapsedTimer timer;
+    timer.start();
+    _server.stopIOProcess();
+    QVERIFY(timer.elapsed() < 500);
+    QVERIFY(!_server.isIOProcessRunning());
+    _server.registerIOProcessObserver(nullptr);
+    QVERIFY2(_server.ioProcess() >= 0, "I/O线程已经停止，预期可以进行IO处理");
+
+    // 在I/O线程的回调中停止自己，不等待线程退出；回调中仍然可以使用加锁的接口
+    std::atomic<bool> stopped = false;
+    QVERIFY(_server.startIOProcess(0));
+    _server.addTimer(0, [this, &stopped] {
+        _server.getIOThreadOptions();
+        _server.stopIOProcess();
+        QVERIFY(!_server.startIOProcess(0));
+        stopped = true;
+    });
+    QTRY_VERIFY_WITH_TIMEOUT(stopped.load() && !_server.isIOProcessRunning(), 500);
+    QVERIFY2(_server.startIOProcess(0), "线程已经在回调中停止，预期可以重新启动");
+    _server.stopIOProcess();
+    QVERIFY(!_server.isIOProcessRunning());
+
+    // 其他线程的ioProcess()进行中时不能启动I/O线程，结束后可以启动并持续运行
+    std::thread external([this] { _server.ioProcess(300); });
+    QTRY_VERIFY_WITH_TIMEOUT(_server.isBusy(), 100);
+    QVERIFY2(!_server.startIOProcess(0), "ioProcess()进行中，预期返回false，实际返回true");
+    external.join();
+    QVERIFY(_server.startIOProcess(10));
+    QTest::qWait(50);
+    QVERIFY2(_server.isIOProcessRunning(), "I/O线程不应退出");
+    _server.stopIOProcess();
+}
+
+void tst_ServerResource::test_ExternalEventLoop()
+{
+#ifdef __linux__
+    auto fd = _server.getFileDescriptor();
+    if(fd < 0)
+        QSKIP("libcoap不支持epoll");
+    auto epfd = epoll_create1(0);
+    QVERIFY(epfd >= 0);
+    struct epoll_event event = {};
+    event.events = EPOLLIN;
+    QCOMPARE(epoll_ctl(epfd, EPOLL_CTL_ADD, fd, &event), 0);
+
+    // 唤醒后外部事件循环的描述符变为可读
+    struct epoll_event events[4];
+    auto timeout = _server.prepareIO();
+    QVERIFY(timeout >= -1);
+    _server.wakeup();
+    QCOMPARE(epoll_wait(epfd, events, 4, 100), 1);
+    _server.processIO();
+
+    // 处理之后没有待处理的事件
+    _server.prepareIO();
+    QCOMPARE(epoll_wait(epfd, events, 4, 0), 0);
+
+    // I/O线程运行期间不能使用外部事件循环
+    QVERIFY(_server.startIOProcess(0));
+    QVERIFY_EXCEPTION_THROWN(_server.processIO(), InternalException);
+    _server.stopIOProcess();
+    ::close(epfd);
+#else
+    QSKIP("仅在Linux上支持外部事件循环");
+#endif
+}
+
+void tst_ServerResource::test_ContextServerGroup()
+{
+    ContextServerGroup group(2);
+    QCOMPARE(group.getWorkerCount(), 2);
+    QVERIFY_EXCEPTION_THROWN(group.getWorker(2), TargetNotFoundException);
+    QVERIFY2(!group.start(), "没有添加端点，预期启动失败");
+
+    QVERIFY(group.addEndPoint(5700));
+    QCOMPARE(group.getWorker(0).getEndPointCount(), 1);
+    QCOMPARE(group.getWorker(1).getEndPointCount(), 1);
+    QVERIFY_EXCEPTION_THROWN(group.getWorker(1).getEndPoint(5700), TargetNotFoundException);
+
+    // 每个工作者注册一份资源
+    const char *uri = "coapcpp/test/group";
+    QVERIFY(group.registerResource([uri]() { return std::make_unique<Resource>(uri, false); }));
+    QVERIFY2(!group.registerResource([uri]() { return std::make_unique<Resource>(uri, false); }), "资源已经注册，预期返回false");
+
+    QVERIFY(group.start(50));
+    QVERIFY(group.isRunning());
+    QVERIFY(group.getWorker(0).isIOProcessRunning());
+    QVERIFY(group.getWorker(1).isIOProcessRunning());
+    QVERIFY2(!group.unregisterResource(uri), "运行中不能注销资源");
+    group.stop();
+    QVERIFY(!group.isRunning());
+    QVERIFY(group.unregisterResource(uri));
+}
+
+void tst_ServerResource::test_Timer()
+{
+    std::atomic<int> once = 0;
+    std::atomic<int> periodic = 0;
+    std::atomic<bool> inIOThread = true;
+    QVERIFY(_server.startIOProcess(0));
+    std::atomic<std::thread::id> ioThread = std::this_thread::get_id();
+    _server.addTimer(0, [&ioThread] { ioThread = std::this_thread::get_id(); });
+    QTRY_VERIFY_WITH_TIMEOUT(ioThread.load() != std::this_thread::get_id(), 100);
+
+    // 无限等待的I/O线程要在定时器到期时醒来
+    QElapsedTimer timer;
+    timer.start();
+    _server.addTimer(30, [&once] { once++; });
+    auto id = _server.addTimer(10, [&] {
+        periodic++;
+        if(std::this_thread::get_id() != ioThread.load())
+            inIOThread = false;
+    }, 10);
+    QTRY_VERIFY_WITH_TIMEOUT(once == 1, 200);
+    QVERIFY(timer.elapsed() >= 30);
+    QTRY_VERIFY_WITH_TIMEOUT(periodic >= 5, 200);
+    QVERIFY2(inIOThread, "定时器回调没有在I/O线程中执行");
+    QVERIFY(_server.cancelTimer(id));
+    QVERIFY2(!_server.cancelTimer(id), "定时器已经取消，预期返回false");
+    auto count = periodic.load();
+    QTest::qWait(50);
+    QCOMPARE(periodic.load(), count);
+    QCOMPARE(once.load(), 1);
+
+    // 回调中取消自身，抛出的异常不影响I/O线程
+    std::atomic<int> self = 0;
+    Context::TimerId selfId = 0;
+    std::atomic<bool> added = false;
+    selfId = _server.addTimer(0, [&] {
+        while(!added);
+        if(++self == 3)
+            _server.cancelTimer(selfId);
+        throw std::runtime_error("test");
+    }, 5);
+    added = true;
+    QTest::qWait(100);
+    QCOMPARE(self.load(), 3);
+    QVERIFY(_server.isIOProcessRunning());
+    _server.stopIOProcess();
+}
+
+void tst_ServerResource::test_ManualClock()
+{
+    ContextServer server;
+    QVERIFY(server.addEndPoint(5690));
+#ifdef __linux__
+    // 加入IOHub后由集线器的线程读取时钟，不能更换
+    if(server.getFileDescriptor() >= 0) {
+        IOHub hub;
+        QVERIFY(hub.addContext(server));
+        QVERIFY(!server.setClock(std::make_unique<ManualClock>()));
+        QVERIFY(hub.removeContext(server));
+    }
+#endif
+    auto clock = new ManualClock(1000);
+    QVERIFY(server.setClock(std::unique_ptr<Clock>(clock)));
+    QCOMPARE(server.getClock().nowMs(), uint64_t(1000));
+
+    const int hour = 3600 * 1000;
+    int hourly = 0;
+    int once = 0;
+    server.addTimer(hour, [&hourly] { hourly++; }, hour);
+    server.addTimer(hour + hour / 2, [&once] { once++; });
+    QVERIFY2(!server.setClock(nullptr), "还有未到期的定时器，预期不能更换时钟");
+
+    // 一天的定时任务应该在很短的时间内确定地跑完
+    QElapsedTimer timer;
+    timer.start();
+    for(int minute = 0; minute < 24 * 60; minute++) {
+        clock->advance(60 * 1000);
+        QVERIFY(server.ioProcess(-1) >= 0);
+        QCOMPARE(hourly, (minute + 1) / 60);
+    }
+    QVERIFY(timer.elapsed() < 1000);
+    QCOMPARE(once, 1);
+
+    // 错过多个周期时只触发一次
+    clock->advance(5 * hour);
+    server.ioProcess(-1);
+    QCOMPARE(hourly, 25);
+    clock->advance(hour - 1);
+    server.ioProcess(-1);
+    QCOMPARE(hourly, 25);
+    clock->advance(1);
+    server.ioProcess(-1);
+    QCOMPARE(hourly, 26);
+}
+
+void tst_ServerResource::test_IOThreadOptions()
+{
+#ifdef __linux__
+    // 普通用户可以调高nice值，也可以绑定到允许的CPU上
+    cpu_set_t allowed;
+    QCOMPARE(sched_getaffinity(0, sizeof(allowed), &allowed), 0);
+    int cpu = 0;
+    while(!CPU_ISSET(cpu, &allowed))
+        cpu++;
+    Context::IOThreadOptions options;
+    options.cpuAffinity = { cpu };
+    options.nice = 5;
+    _server.setIOThreadOptions(options);
+    QCOMPARE(_server.getIOThreadOptions().cpuAffinity, std::vector<int>{ cpu });
+
+    auto mainNice = getpriority(PRIO_PROCESS, static_cast<id_t>(syscall(SYS_gettid)));
+    std::atomic<int> runCpu = -1;
+    std::atomic<int> runNice = 0;
+    QVERIFY(_server.startIOProcess(0));
+    _server.addTimer(0, [&] {
+        runNice = getpriority(PRIO_PROCESS, static_cast<id_t>(syscall(SYS_gettid)));
+        runCpu = sched_getcpu();
+    });
+    QTRY_VERIFY_WITH_TIMEOUT(runCpu >= 0, 500);
+    QCOMPARE(runCpu.load(), cpu);
+    QCOMPARE(runNice.load(), 5);
+    // 配置只作用于I/O线程
+    QCOMPARE(getpriority(PRIO_PROCESS, static_cast<id_t>(syscall(SYS_gettid))), mainNice);
+    _server.stopIOProcess();
+    _server.setIOThreadOptions(Context::IOThreadOptions());
+#else
+    QSKIP("I/O线程配置仅支持Linux");
+#endif
+}
+
+void tst_ServerResource::test_IOHub()
+{
+#ifdef __linux__
+    if(_server.getFileDescriptor() < 0)
+        QSKIP("libcoap不支持epoll");
+    IOHub hub;
+    std::vector<std::unique_ptr<ContextServer>> servers;
+    for(int i = 0; i < 8; i++) {
+        servers.push_back(std::make_unique<ContextServer>());
+        QVERIFY(servers.back()->addEndPoint(5710 + i));
+        QVERIFY(hub.addContext(*servers.back()));
+    }
+    QCOMPARE(hub.getContextCount(), size_t(8));
+    QVERIFY2(!hub.addContext(*servers.front()), "重复加入，预期返回false");
+    QVERIFY2(!servers.front()->startIOProcess(), "已经加入IOHub，预期不能启动自己的I/O线程");
+
+    // 每个Context的定时器都在集线器的线程中执行
+    QVERIFY(hub.start());
+    QCOMPARE(hub.ioProcess(), -1);
+    std::atomic<int> count = 0;
+    std::atomic<std::thread::id> hubThread;
+    std::atomic<bool> sameThread = true;
+    for(auto& server : servers) {
+        server->addTimer(20, [&] {
+            auto id = std::this_thread::get_id();
+            std::thread::id expected;
+            if(!hubThread.compare_exchange_strong(expected, id) && expected != id)
+                sameThread = false;
+            count++;
+        });
+    }
+    QTRY_COMPARE_WITH_TIMEOUT(count.load(), 8, 500);
+    QVERIFY(sameThread);
+    QVERIFY(hubThread.load() != std::this_thread::get_id());
+
+    // 析构的Context自动从集线器中移除
+    servers.pop_back();
+    QCOMPARE(hub.getContextCount(), size_t(7));
+    QVERIFY(hub.removeContext(*servers.front()));
+    QVERIFY(servers.front()->startIOProcess());
+    servers.front()->stopIOProcess();
+
+    // 集线器调用Context时不持有锁，回调中移除自己和其他Context不会死锁
+    std::atomic<bool> removed = false;
+    auto self = servers[1].get();
+    auto other = servers[2].get();
+    self->addTimer(0, [&hub, self, other, &removed] {
+        removed = hub.removeContext(*self) && hub.removeContext(*other);
+    });
+    QTRY_VERIFY_WITH_TIMEOUT(removed.load(), 500);
+    QCOMPARE(hub.getContextCount(), size_t(4));
+
+    hub.stop();
+    QVERIFY(!hub.isRunning());
+    count = 0;
+    servers.back()->addTimer(0, [&count] { count++; });
+    QVERIFY(hub.ioProcess(-1) >= 0);
+    QCOMPARE(count.load(), 1);
+#else
+    QSKIP("IOHub仅支持Linux");
+#endif
+}
+
+void tst_ServerResource::test_ReadAhead()
+{
+#ifdef __linux__
+    if(_server.getFileDescriptor() < 0)
+        QSKIP("libcoap不支持epoll");
+    const uint16_t port = 5720;
+    const int requestCount = 32;
+    ContextServer server;
+    QVERIFY(server.addEndPoint(port));
+    QCOMPARE(server.getMaxReadsPerIOProcess(), size_t(1));
+    QVERIFY(server.setMaxReadsPerIOProcess(requestCount * 2));
+    QCOMPARE(server.getMaxReadsPerIOProcess(), size_t(requestCount * 2));
+
+    coap_address_t address;
+    coap_address_init(&address);
+    address.addr.sin.sin_family = AF_INET;
+    address.addr.sin.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    address.addr.sin.sin_port = htons(port);
+    auto session = coap_new_client_session(m_context, nullptr, &address, COAP_PROTO_UDP);
+    QVERIFY(session);
+    for(int i = 0; i < requestCount; i++) {
+        auto pdu = coap_new_pdu(COAP_MESSAGE_NON, COAP_REQUEST_CODE_GET, session);
+        QVERIFY(pdu);
+        QVERIFY(coap_send(session, pdu) != COAP_INVALID_MID);
+    }
+
+    // 一次网络I/O处理读取所有已经到达的数据报
+    QVERIFY(server.ioProcess(-1) >= 0);
+    auto stats = server.getReadAheadStats();
+    QCOMPARE(stats.passes, uint64_t(1));
+    QVERIFY(stats.datagrams >= requestCount / 2 && stats.datagrams < requestCount);
+    QCOMPARE(stats.maxPerPass, stats.datagrams);
+    uint64_t total = 0;
+    for(auto count : stats.histogram)
+        total += count;
+    QCOMPARE(total, uint64_t(1));
+
+    // 没有数据报时不计入预读次数
+    QVERIFY(server.ioProcess(-1) >= 0);
+    QCOMPARE(server.getReadAheadStats().passes, uint64_t(1));
+    coap_session_release(session);
+#else
+    QSKIP("预读仅支持Linux");
+#endif
+}
+
+void tst_ServerResource::test_BusyPoll()
+{
+#ifdef __linux__
+    if(_server.getFileDescriptor() < 0)
+        QSKIP("libcoap不支持epoll");
+    const uint16_t port = 5740;
+    ContextServer server;
+    QVERIFY(server.addEndPoint(port));
+    Context::IOThreadOptions options;
+    options.busyPollUs = 20000;
+    server.setIOThreadOptions(options);
+    QVERIFY(server.startIOProcess(0));
+
+    // 启动后先忙轮询一个窗口，没有数据报则退回到阻塞等待
+    QTRY_VERIFY_WITH_TIMEOUT(server.getBusyPollStats().sleeps > 2, 1000);
+    auto idle = server.getBusyPollStats();
+    QVERIFY(idle.spinPolls > 0);
+    QVERIFY(idle.spinUs >= 15000);
+    QCOMPARE(idle.spinHits, uint64_t(0));
+
+    coap_address_t address;
+    coap_address_init(&address);
+    address.addr.sin.sin_family = AF_INET;
+    address.addr.sin.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    address.addr.sin.sin_port = htons(port);
+    auto session = coap_new_client_session(m_context, nullptr, &address, COAP_PROTO_UDP);
+    QVERIFY(session);
+    static std::atomic<int> responses;
+    responses = 0;
+    coap_register_response_handler(m_context, [](coap_session_t*, const coap_pdu_t*, const coap_pdu_t*, const coap_mid_t) {
+        responses++;
+        return COAP_RESPONSE_OK;
+    });
+
+    // 第一个数据报在阻塞等待中收到，随后的数据报在忙轮询窗口内收到
+    for(int i = 0; i < 3; i++) {
+        auto pdu = coap_new_pdu(COAP_MESSAGE_CON, COAP_REQUEST_CODE_GET, session);
+        QVERIFY(pdu);
+        QVERIFY(coap_send(session, pdu) != COAP_INVALID_MID);
+        QElapsedTimer timer;
+        timer.start();
+        while(responses <= i && timer.elapsed() < 1000)
+            coap_io_process(m_context, 1);
+    }
+    QCOMPARE(responses.load(), 3);
+    server.stopIOProcess();
+    auto busy = server.getBusyPollStats();
+    QVERIFY(busy.spinHits > 0);
+    QVERIFY(busy.spinPolls > idle.spinPolls);
+    QVERIFY(busy.sleepUs > 0);
+    coap_register_response_handler(m_context, nullptr);
+    coap_session_release(session);
+#else
+    QSKIP("忙轮询仅支持Linux");
+#endif
+}
+
+namespace {
+// 开放关闭接口，模拟子类析构函数中的调用
+class ShutdownServer : public ContextServer
+{
+public:
+    using ContextServer::shutdownIOProcess;
+};
+}
+
+void tst_ServerResource::test_ShutdownDuringIOProcess()
+{
+    const uint16_t port = 5750;
+    // 一个线程持续调用ioProcess()，另一个线程关闭：关闭返回前进行中的I/O已经结束，之后的调用都返回-1
+    for(int round = 0; round < 20; round++) {
+        ShutdownServer server;
+        QVERIFY(server.addEndPoint(port));
+        std::atomic<int> calls = 0;
+        std::atomic<bool> refused = false;
+        std::thread io([&] {
+            while(refused == false) {
+                if(server.ioProcess(10) < 0)
+                    refused = true;
+                else
+                    calls++;
+            }
+        });
+        QTRY_VERIFY_WITH_TIMEOUT(calls > 0 || server.isBusy(), 1000);
+        server.shutdownIOProcess();
+        QVERIFY(!server.isBusy());
+        io.join();
+        QVERIFY(refused.load());
+        QCOMPARE(server.ioProcess(10), -1);
+        QVERIFY(!server.startIOProcess(10));
+    }
+
+    // 析构等待阻塞中的ioProcess()返回，ioProcess()返回后不再访问已经释放的对象（配合ASan/TSan运行）
+    for(int round = 0; round < 20; round++) {
+        auto server = new ContextServer();
+        QVERIFY(server->addEndPoint(port));
+        std::atomic<bool> entered = false;
+        std::atomic<int> result = -2;
+        std::thread io([&] {
+            entered = true;
+            result = server->ioProcess(round % 2 ? 0 : 300);
+        });
+        QTRY_VERIFY_WITH_TIMEOUT(entered && server->isBusy(), 1000);
+        QElapsedTimer timer;
+        timer.start();
+        delete server;
+        // 关闭时会唤醒阻塞中的I/O，不会等到超时或者一直等待
+        QVERIFY(timer.elapsed() < 250);
+        io.join();
+        QVERIFY(result >= 0);
+    }
+}
+
 void tst_ServerResource::test_ResourceRegister()
 {
     const char *uri1 = "coap://[::1]:40288/coapcpp/test/resource?isObs=true";
@@ -72,8 +567,17 @@ void tst_ServerResource::test_ResourceRegister()
     QVERIFY2(!manager.unregisterResource(uri1), "资源还没注册，预期返回false，实际返回true");
     QVERIFY2(manager.registerResource(std::make_unique<Resource>(uri1, true)), "无法注册resource_obs_on");
     QVERIFY2(manager.registerResource(std::make_unique<Resource>(uri2, false)), "无法注册resource_obs_off");
+
+    // 批量通知，未注册的资源在网络I/O的线程中被忽略
+    std::vector<std::string> uris = { uri1, uri2, "coap://[::1]:40288/coapcpp/test/none" };
+    manager.notifyObservers(uris);
+    QVERIFY(_server.ioProcess(-1) >= 0);
+
+    // 通知排队期间资源被注销
+    manager.notifyObservers(uris);
     QVERIFY(manager.unregisterResource(uri1));
     QVERIFY(manager.unregisterResource(uri2));
+    QVERIFY(_server.ioProcess(-1) >= 0);
 }
 
 void tst_ServerResource::test_Resource()
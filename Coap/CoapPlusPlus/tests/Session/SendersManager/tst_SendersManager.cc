@@ -3,6 +3,7 @@
 #include <QDebug>
 #include <QByteArray>
 #include <QString>
+#include <QElapsedTimer>
 
 #include "coap/ContextClient.h"
 #include "coap/Session.h"
@@ -11,7 +12,12 @@
 #include "coap/SendersManager.h"
 #include "coap/Pdu/RequestPdu.h"
 #include "coap/Handling.h"
+#include "coap/RequestAwaitable.h"
+#include "coap/Response.h"
 #include "TestHandling.h"
+#include <atomic>
+#include <thread>
+#include <vector>
 
 using namespace CoapPlusPlus;
 
@@ -61,6 +67,14 @@ private slots:
 
     void test_sendAndUpdateDefaultHandling(); // 测试默认Handling
 
+    void test_submit(); // 测试多线程提交请求
+
+    void test_request(); // 测试协程请求接口
+
+    void test_sendFuture(); // 测试future请求接口与期限
+
+    void test_sendWithoutWakeup(); // 测试连续发送后只唤醒一次
+
 };
 
 void tst_SendersManager::startServer()
@@ -84,6 +98,24 @@ void tst_SendersManager::stopServer()
 }
 
 
+// 依次发送count个请求，记录每个响应的响应码，未正常应答记为-1
+static DetachedTask RequestChain(SendersManager& manager, int count, std::vector<int>& codes, int& finished)
+{
+    using namespace Information;
+    for(int i = 0; i < count; i++) {
+        auto result = co_await manager.request(manager.createRequest(MessageType::Confirmable, RequestCode::Get));
+        codes.push_back(result.isAck() ? static_cast<int>(result.response->code()) : -1);
+    }
+    finished++;
+}
+
+static DetachedTask RequestOnce(SendersManager& manager, RequestPdu pdu, std::optional<Handling::NAckReason>& reason, bool& finished)
+{
+    auto result = co_await manager.request(std::move(pdu));
+    reason = result.nackReason;
+    finished = true;
+}
+
 QTEST_MAIN(tst_SendersManager)
 
 #include "tst_SendersManager.moc"
@@ -111,7 +143,14 @@ void tst_SendersManager::test_SendersManager()
 
     // HANDLING
     QVERIFY_EXCEPTION_THROWN(_test_sendersManager->getHandling(token), TargetNotFoundException);
+    QVERIFY(_test_sendersManager->tryGetHandling(token) == nullptr);
     QVERIFY(!_test_sendersManager->removeHandling(token));
+
+    // 超过8个字节的token不会有对应的处理器
+    uint8_t longTokenData[9] = { 1, 2, 3, 4, 5, 6, 7, 8, 9 };
+    auto longToken = BinaryConst::Create(sizeof(longTokenData), longTokenData);
+    QVERIFY(_test_sendersManager->tryGetHandling(longToken) == nullptr);
+    QVERIFY(!_test_sendersManager->removeHandling(longToken));
 }
 
 void tst_SendersManager::test_sendAndHandling_case1()
@@ -267,4 +306,194 @@ void tst_SendersManager::test_sendAndUpdateDefaultHandling()
     QCOMPARE(handlingData->isDestroy(), false);
 
     delete handlingData;
-}
\ No newline at end of file
+}
+
+void tst_SendersManager::test_submit()
+{
+    startServer();
+    const int threadCount = 4;
+    const int requestCount = 8;
+    auto handlingData = new TestHandlingData(0);
+    std::atomic<int> built = 0;
+    std::atomic<int> acked = 0;
+    // 处理器的计数在I/O线程中修改，另用一个原子计数让主线程等待
+    class CountingHandling : public TestHandling {
+    public:
+        CountingHandling(TestHandlingData* data, BinaryConst token, std::atomic<int>& acked) noexcept
+            : TestHandling(data, token), m_acked(acked) { }
+        bool onAck(Session& session, const RequestPdu* request, const ResponsePdu* response) noexcept override {
+            auto result = TestHandling::onAck(session, request, response);
+            m_acked++;
+            return result;
+        }
+    private:
+        std::atomic<int>& m_acked;
+    };
+
+    // 各个线程在I/O线程运行期间提交请求，请求和token由I/O线程创建
+    QVERIFY(_test_client.startIOProcess(10));
+    QVERIFY2(!_test_client.addSession(_port + 1), "I/O线程正在运行，预期不能添加会话");
+    QVERIFY2(!_test_client.removeSession(_port, Information::Udp), "I/O线程正在运行，预期不能移除会话");
+    std::vector<std::thread> producers;
+    for(int t = 0; t < threadCount; t++) {
+        producers.emplace_back([this, handlingData, &built, &acked]() {
+            for(int i = 0; i < requestCount; i++) {
+                _test_client.submit(_port, Information::Udp, MessageType::Confirmable, RequestCode::Get, 
+                    [handlingData, &built, &acked](RequestPdu& pdu) -> std::unique_ptr<Handling> {
+                        auto handling = std::make_unique<CountingHandling>(handlingData, pdu.token().toBinaryConst(), acked);
+                        handling->setFinished(true);
+                        built++;
+                        return handling;
+                    });
+            }
+        });
+    }
+    for(auto& producer : producers)
+        producer.join();
+
+    // 服务器在主线程中处理，处理器的计数只在I/O线程停止后读取
+    QElapsedTimer timer;
+    timer.start();
+    while(acked < threadCount * requestCount && timer.elapsed() < 5000)
+        coap_io_process(_test_server, 10);
+    _test_client.stopIOProcess();
+    QCOMPARE(built.load(), threadCount * requestCount);
+    QCOMPARE(handlingData->number(), threadCount * requestCount);
+    delete handlingData;
+}
+
+void tst_SendersManager::test_request()
+{
+    using namespace Information;
+    startServer();
+    const int chainCount = 16;
+    const int requestCount = 4;
+    std::vector<std::vector<int>> codes(chainCount);
+    int finished = 0;
+    for(auto& list : codes)
+        RequestChain(*_test_sendersManager, requestCount, list, finished);
+
+    QElapsedTimer timer;
+    timer.start();
+    while(finished < chainCount && timer.elapsed() < 5000) {
+        _test_client.ioProcess(-1);
+        coap_io_process(_test_server, COAP_IO_NO_WAIT);
+    }
+    QCOMPARE(finished, chainCount);
+    for(auto& list : codes) {
+        QCOMPARE(list.size(), size_t(requestCount));
+        for(auto code : list)
+            QCOMPARE(code, static_cast<int>(ResponseCode::NotFound));   // 测试服务器没有资源
+    }
+
+    // 移除等待中的请求，协程以NotDelivered恢复
+    stopServer();
+    auto pdu = _test_sendersManager->createRequest(MessageType::Confirmable, RequestCode::Get);
+    auto token = pdu.token().toBinaryConst();
+    std::optional<Handling::NAckReason> reason;
+    bool done = false;
+    RequestOnce(*_test_sendersManager, std::move(pdu), reason, done);
+    QVERIFY(done == false);
+    QVERIFY(_test_sendersManager->removeHandling(token));
+    QVERIFY(done);
+    QVERIFY(reason.has_value());
+    QCOMPARE(reason.value(), Handling::NotDelivered);
+}
+
+void tst_SendersManager::test_sendFuture()
+{
+    using namespace Information;
+    auto waitFuture = [this](std::future<Response>& future) {
+        QElapsedTimer timer;
+        timer.start();
+        while(future.wait_for(std::chrono::seconds(0)) != std::future_status::ready && timer.elapsed() < 5000) {
+            _test_client.ioProcess(-1);
+            coap_io_process(_test_server, COAP_IO_NO_WAIT);
+        }
+        return future.wait_for(std::chrono::seconds(0)) == std::future_status::ready;
+    };
+
+    // 收到响应，结果中的报文在回调结束后仍然可用
+    startServer();
+    auto future = _test_sendersManager->sendFuture(_test_sendersManager->createRequest(MessageType::Confirmable, RequestCode::Get), 2000);
+    QVERIFY(waitFuture(future));
+    auto response = future.get();
+    QCOMPARE(response.status(), Response::Ack);
+    QCOMPARE(response.pdu().code(), ResponseCode::NotFound);
+
+    // 服务器不响应，期限到后处理器被移除
+    stopServer();
+    auto pdu = _test_sendersManager->createRequest(MessageType::Confirmable, RequestCode::Get);
+    auto token = pdu.token().toBinaryConst();
+    future = _test_sendersManager->sendFuture(std::move(pdu), 100);
+    QVERIFY(_test_sendersManager->getHandling(token));
+    QCOMPARE(_test_sendersManager->tryGetHandling(token), _test_sendersManager->getHandling(token));
+    QVERIFY(waitFuture(future));
+    response = future.get();
+    QCOMPARE(response.status(), Response::Timeout);
+    QVERIFY_EXCEPTION_THROWN(response.pdu(), DataNotReadyException);
+    QVERIFY_EXCEPTION_THROWN(_test_sendersManager->getHandling(token), TargetNotFoundException);
+    QVERIFY(_test_sendersManager->tryGetHandling(token) == nullptr);
+
+    // 其他线程提交，会话不存在
+    std::future<Response> submitted;
+    std::thread producer([this, &submitted]() {
+        submitted = _test_client.submitFuture(_port + 1, Information::Udp, MessageType::Confirmable, RequestCode::Get, nullptr, 100);
+    });
+    producer.join();
+    QVERIFY(waitFuture(submitted));
+    response = submitted.get();
+    QCOMPARE(response.status(), Response::NAck);
+    QCOMPARE(response.nackReason(), Handling::NotDelivered);
+
+    // builder抛出异常，请求不会被发送
+    submitted = _test_client.submitFuture(_port, Information::Udp, MessageType::Confirmable, RequestCode::Get,
+                                          [](RequestPdu&) { throw std::runtime_error("builder failed"); });
+    QVERIFY(waitFuture(submitted));
+    response = submitted.get();
+    QCOMPARE(response.status(), Response::NAck);
+    QCOMPARE(response.nackReason(), Handling::NotDelivered);
+
+    // I/O线程运行期间在其他线程提交，请求和token由I/O线程创建
+    startServer();
+    QVERIFY(_test_client.startIOProcess(10));
+    std::atomic<bool> built = false;
+    producer = std::thread([this, &submitted, &built]() {
+        submitted = _test_client.submitFuture(_port, Information::Udp, MessageType::Confirmable, RequestCode::Get,
+                                              [&built](RequestPdu& pdu) { built = pdu.token().size() > 0; }, 2000);
+    });
+    producer.join();
+    QElapsedTimer timer;
+    timer.start();
+    while(submitted.wait_for(std::chrono::seconds(0)) != std::future_status::ready && timer.elapsed() < 5000)
+        coap_io_process(_test_server, 10);
+    _test_client.stopIOProcess();
+    QVERIFY(built);
+    response = submitted.get();
+    QCOMPARE(response.status(), Response::Ack);
+    QCOMPARE(response.pdu().code(), ResponseCode::NotFound);
+}
+
+void tst_SendersManager::test_sendWithoutWakeup()
+{
+    using namespace Information;
+    startServer();
+    const int requestCount = 16;
+    auto handlingData = new TestHandlingData(0);
+    for(int i = 0; i < requestCount; i++) {
+        auto pdu = _test_sendersManager->createRequest(MessageType::Confirmable, RequestCode::Get);
+        auto handling = std::make_unique<TestHandling>(handlingData, pdu.token().toBinaryConst());
+        handling->setFinished(true);
+        QVERIFY(_test_sendersManager->sendWithoutWakeup(std::move(pdu), std::move(handling)));
+    }
+    _test_sendersManager->wakeupContext();
+
+    QElapsedTimer timer;
+    timer.start();
+    while(handlingData->number() < requestCount && timer.elapsed() < 5000) {
+        _test_client.ioProcess(-1);
+        coap_io_process(_test_server, COAP_IO_NO_WAIT);
+    }
+    QCOMPARE(handlingData->number(), requestCount);
+    delete handlingData;
+}
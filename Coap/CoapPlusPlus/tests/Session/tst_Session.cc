@@ -7,6 +7,7 @@
 #include <coap3/coap.h>
 #include "coap/ContextClient.h"
 #include "coap/Session.h"
+#include "coap/SessionView.h"
 #include "coap/exception.h"
 #include "coap/DataStruct/Address.h"
 
@@ -33,6 +34,8 @@ private slots:
     void test_ContextClient();
 
     void test_Session();
+
+    void test_SessionView();
 };
 
 QTEST_MAIN(tst_Session)
@@ -80,3 +83,27 @@ void tst_Session::test_Session()
     QVERIFY(context != nullptr);
     QCOMPARE(context, &_test_client);
 }
+
+void tst_Session::test_SessionView()
+{
+    QVERIFY_EXCEPTION_THROWN(SessionView(nullptr), std::invalid_argument);
+
+    // 视图与Session访问同一个libcoap会话
+    SessionView view = *_test_session;
+    QVERIFY(view == *_test_session);
+    QVERIFY(!view.isReadOnly());
+    QCOMPARE(view.getProtocol(), Information::Udp);
+    QCOMPARE(view.getRemoteAddress().getPort(), _port);
+    QVERIFY(qFuzzyCompare(view.getAckTimeout(), _test_session->getAckTimeout()));
+
+    view.setNSTART(2);
+    QCOMPARE(_test_session->getNSTART(), 2);
+    view.setNSTART(0);
+    QCOMPARE(_test_session->getNSTART(), 2);
+
+    // 复制视图不会转移或释放会话
+    auto copy = view;
+    QVERIFY(copy == view);
+    QCOMPARE(copy.getContext(), static_cast<const Context*>(&_test_client));
+    QCOMPARE(_test_session->getSessionState(), Information::Established);
+}
@@ -0,0 +1,115 @@
+#include <QtTest>
+#include <QDebug>
+#include <vector>
+
+#include "coap/TimerWheel.h"
+
+using namespace CoapPlusPlus;
+
+class tst_TimerWheel : public QObject {
+    Q_OBJECT
+public:
+    tst_TimerWheel() { }
+    ~tst_TimerWheel() { }
+
+private:
+    /**
+     * @brief 推进时间并执行所有到期的定时器，返回到期的定时器id
+     */
+    std::vector<TimerWheel::TimerId> fire(TimerWheel& wheel, uint64_t now) {
+        std::vector<TimerWheel::TimerId> ids;
+        TimerWheel::Expired expired;
+        while(wheel.popExpired(now, expired)) {
+            ids.push_back(expired.id);
+            expired.callback();
+            if(expired.period > 0)
+                wheel.rearm(std::move(expired));
+        }
+        return ids;
+    }
+
+private slots:
+    void test_schedule(); // 测试各层以及溢出链表中的定时器按时到期
+    void test_cancel(); // 测试取消定时器
+    void test_periodic(); // 测试周期定时器
+};
+
+void tst_TimerWheel::test_schedule()
+{
+    const uint64_t start = 1000;
+    TimerWheel wheel(start);
+    QVERIFY(wheel.empty());
+    QVERIFY(!wheel.nextExpire().has_value());
+
+    // 分别落在第0层、第1层、第3层、溢出链表，以及已经过期
+    const std::vector<uint64_t> delays = { 5, 100, 5000, 10'000'000, 20'000'000 };
+    std::vector<TimerWheel::TimerId> ids;
+    for(auto delay : delays)
+        ids.push_back(wheel.schedule(start + delay, 0, [] { }));
+    auto expiredId = wheel.schedule(start - 10, 0, [] { });
+    QCOMPARE(wheel.size(), delays.size() + 1);
+    QCOMPARE(wheel.nextExpire().value(), start);
+    QCOMPARE(fire(wheel, start), std::vector<TimerWheel::TimerId>{ expiredId });
+
+    for(size_t i = 0; i < delays.size(); i++) {
+        QCOMPARE(wheel.nextExpire().value(), start + delays[i]);
+        QVERIFY2(fire(wheel, start + delays[i] - 1).empty(), "定时器提前到期");
+        QCOMPARE(fire(wheel, start + delays[i]), std::vector<TimerWheel::TimerId>{ ids[i] });
+    }
+    QVERIFY(wheel.empty());
+
+    // 一次推进很长的时间，所有定时器按到期时间的顺序取出
+    auto a = wheel.schedule(start + 30'000'000, 0, [] { });
+    auto b = wheel.schedule(start + 20'000'100, 0, [] { });
+    auto c = wheel.schedule(start + 20'000'001, 0, [] { });
+    QCOMPARE(fire(wheel, start + 40'000'000), (std::vector<TimerWheel::TimerId>{ c, b, a }));
+}
+
+void tst_TimerWheel::test_cancel()
+{
+    TimerWheel wheel(0);
+    int count = 0;
+    auto a = wheel.schedule(10, 0, [&count] { count++; });
+    auto b = wheel.schedule(5000, 0, [&count] { count++; });
+    QVERIFY(wheel.cancel(a));
+    QVERIFY2(!wheel.cancel(a), "定时器已经取消，预期返回false");
+    QCOMPARE(wheel.nextExpire().value(), uint64_t(5000));
+    QVERIFY(wheel.cancel(b));
+    QVERIFY(!wheel.nextExpire().has_value());
+    QVERIFY(fire(wheel, 10000).empty());
+    QCOMPARE(count, 0);
+
+    // 一次性定时器到期后不能再取消
+    auto c = wheel.schedule(10010, 0, [&count] { count++; });
+    QCOMPARE(fire(wheel, 10010).size(), size_t(1));
+    QVERIFY(!wheel.cancel(c));
+    QCOMPARE(count, 1);
+}
+
+void tst_TimerWheel::test_periodic()
+{
+    TimerWheel wheel(0);
+    int count = 0;
+    auto id = wheel.schedule(10, 10, [&count] { count++; });
+    for(uint64_t now = 0; now <= 100; now++)
+        fire(wheel, now);
+    QCOMPARE(count, 10);
+    QCOMPARE(wheel.nextExpire().value(), uint64_t(110));
+
+    // 错过多个周期时只触发一次，然后从当前时间开始计算下一个周期
+    fire(wheel, 1005);
+    QCOMPARE(count, 11);
+    QCOMPARE(wheel.nextExpire().value(), uint64_t(1015));
+
+    // 回调执行期间取消，不会重新加入时间轮
+    TimerWheel::Expired expired;
+    QVERIFY(wheel.popExpired(1015, expired));
+    QCOMPARE(expired.id, id);
+    QVERIFY(wheel.cancel(id));
+    wheel.rearm(std::move(expired));
+    QVERIFY(wheel.empty());
+}
+
+QTEST_MAIN(tst_TimerWheel)
+
+#include "tst_TimerWheel.moc"
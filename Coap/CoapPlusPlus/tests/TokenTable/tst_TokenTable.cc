@@ -0,0 +1,132 @@
+#include <QtTest>
+#include <QDebug>
+#include <array>
+#include <map>
+#include <random>
+#include <vector>
+
+#include "coap/TokenTable.h"
+
+using namespace CoapPlusPlus;
+
+class tst_TokenTable : public QObject {
+    Q_OBJECT
+public:
+    tst_TokenTable() { }
+    ~tst_TokenTable() { }
+
+private:
+    using Table = TokenTable<int>;
+
+    static Table::Key key(std::vector<uint8_t> token) {
+        Table::Key result;
+        if(Table::MakeKey(token, result) == false)
+            qFatal("token is too long");
+        return result;
+    }
+
+private slots:
+    void test_key(); // 测试由token构造键
+    void test_insertFindErase(); // 测试插入、查找和移除
+    void test_randomized(); // 与std::map对照测试大量随机的插入和移除
+};
+
+void tst_TokenTable::test_key()
+{
+    Table::Key a, b;
+    QVERIFY(Table::MakeKey(std::vector<uint8_t>{ 0x01, 0x02 }, a));
+    QCOMPARE(a.packed, uint64_t(0x0102));
+    QCOMPARE(a.length, uint8_t(2));
+
+    // 前导0字节由长度区分
+    QVERIFY(Table::MakeKey(std::vector<uint8_t>{ 0x00, 0x01, 0x02 }, b));
+    QCOMPARE(b.packed, a.packed);
+    QVERIFY(!(a == b));
+
+    // 空token也是合法的键
+    QVERIFY(Table::MakeKey(std::span<const uint8_t>(), b));
+    QCOMPARE(b.length, uint8_t(0));
+
+    QVERIFY(Table::MakeKey(std::vector<uint8_t>(8, 0xFF), b));
+    QCOMPARE(b.packed, UINT64_MAX);
+    QVERIFY(!Table::MakeKey(std::vector<uint8_t>(9, 0xFF), b));
+}
+
+void tst_TokenTable::test_insertFindErase()
+{
+    Table table;
+    int a = 1, b = 2;
+    QVERIFY(table.empty());
+    QVERIFY(table.find(key({ 1 })) == nullptr);
+    QVERIFY(table.erase(key({ 1 })) == nullptr);
+
+    QVERIFY(table.insert(key({ 1 }), &a));
+    QVERIFY(table.insert(key({ 0, 1 }), &b));
+    QVERIFY(!table.insert(key({ 1 }), &b));
+    QVERIFY(!table.insert(key({ 2 }), nullptr));
+    QCOMPARE(table.size(), size_t(2));
+    QCOMPARE(table.find(key({ 1 })), &a);
+    QCOMPARE(table.find(key({ 0, 1 })), &b);
+
+    QCOMPARE(table.erase(key({ 1 })), &a);
+    QVERIFY(table.find(key({ 1 })) == nullptr);
+    QCOMPARE(table.find(key({ 0, 1 })), &b);
+    QCOMPARE(table.size(), size_t(1));
+
+    int count = 0;
+    table.forEach([&count](int*) { count++; });
+    QCOMPARE(count, 1);
+    table.clear();
+    QVERIFY(table.empty());
+    QVERIFY(table.find(key({ 0, 1 })) == nullptr);
+}
+
+void tst_TokenTable::test_randomized()
+{
+    Table table;
+    std::map<std::pair<uint64_t, uint8_t>, int*> reference;
+    std::vector<int> values(20000);
+    std::mt19937_64 random(42);
+
+    // 递增的token与随机的token混合，模拟libcoap生成的token和大量未完成的请求
+    auto makeKey = [&random](int i) {
+        Table::Key result;
+        result.length = static_cast<uint8_t>(i % 2 == 0 ? 8 : 1 + random() % 8);
+        result.packed = i % 2 == 0 ? 0x1000 + i : random() >> (64 - result.length * 8);
+        return result;
+    };
+    std::vector<Table::Key> keys;
+    for(int i = 0; i < 20000; i++) {
+        auto k = makeKey(i);
+        bool inserted = reference.emplace(std::make_pair(k.packed, k.length), &values[i]).second;
+        QCOMPARE(table.insert(k, &values[i]), inserted);
+        if(inserted)
+            keys.push_back(k);
+        // 穿插移除，触发后移
+        if(i % 3 == 0 && keys.empty() == false) {
+            auto index = random() % keys.size();
+            auto removed = keys[index];
+            keys[index] = keys.back();
+            keys.pop_back();
+            auto it = reference.find({ removed.packed, removed.length });
+            QCOMPARE(table.erase(removed), it->second);
+            reference.erase(it);
+        }
+    }
+    QCOMPARE(table.size(), reference.size());
+    QVERIFY(table.size() > 10000);
+    QVERIFY(table.size() * 4 <= table.capacity() * 3);
+    for(auto& [k, value] : reference)
+        QCOMPARE(table.find(Table::Key{ k.first, k.second }), value);
+
+    // 全部移除后表为空
+    for(auto& k : keys)
+        QVERIFY(table.erase(k) != nullptr);
+    QVERIFY(table.empty());
+    for(auto& [k, value] : reference)
+        QVERIFY(table.find(Table::Key{ k.first, k.second }) == nullptr);
+}
+
+QTEST_MAIN(tst_TokenTable)
+
+#include "tst_TokenTable.moc"